@@ -1,10 +1,13 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include "TVector3.h"
 
 #include "TreeUtilities.h"
 #include "Constants.h"
+#include "MatchIndex.h"
+#include "DerivedKinematics.h"
 
 enum EventCategory
 {
@@ -18,8 +21,32 @@ enum EventCategory
     kNuMuCCOther = 7,
     kNC = 8,
     kOther = 9,
+    kNumEventCategories = 10
 };
 
+// Truth-topology bits, derived once per event at ingest
+enum TopologyFlag : uint32_t
+{
+    kTopoNeutrino = 1u << 0,
+    kTopoNuMu = 1u << 1,
+    kTopoCC = 1u << 2,
+    kTopoMuon = 1u << 3,
+    kTopoKShort = 1u << 4,
+    kTopoKShortPionic = 1u << 5,
+    kTopoNeutralKaon = 1u << 6,
+    kTopoChargedKaon = 1u << 7,
+    kTopoLambda = 1u << 8,
+    kTopoSigmaPlus = 1u << 9,
+    kTopoSigmaMinus = 1u << 10,
+    kTopoSigmaZero = 1u << 11,
+    kTopoHyperon = 1u << 12,
+    kTopoProton = 1u << 13,
+    kTopoChargedPion = 1u << 14,
+    kTopoPiZero = 1u << 15
+};
+
+constexpr uint32_t kTopoSignal = kTopoNuMu | kTopoCC | kTopoMuon | kTopoKShortPionic;
+
 struct AnalysisEvent
 {
     int event, run, subrun;
@@ -79,8 +106,9 @@ struct AnalysisEvent
     unsigned int mc_kshrt_piminus_n_elas;
     unsigned int mc_kshrt_piminus_n_inelas;
 
-    tree_utils::ManagedPointer<std::string> mc_kshrt_piplus_endprocess;
-    tree_utils::ManagedPointer<std::string> mc_kshrt_piminus_endprocess;
+    // Interned per file; EventAssembler::get_end_process_name decodes them
+    mutable uint16_t mc_kshrt_piplus_endprocess;
+    mutable uint16_t mc_kshrt_piminus_endprocess;
 
     bool mc_is_kshort_decay_pionic;
 
@@ -90,6 +118,7 @@ struct AnalysisEvent
     bool mc_has_sigma_zero;
 
     mutable EventCategory category;
+    mutable uint32_t topology;
 
     // **** Reconstruction variables ****
     float topological_score;
@@ -120,78 +149,132 @@ struct AnalysisEvent
     tree_utils::ManagedPointer<std::vector<int>> bt_pdg; 
     tree_utils::ManagedPointer<std::vector<std::vector<unsigned int>>> bt_tids;
     tree_utils::ManagedPointer<std::vector<float>> bt_energy;
+
+    mutable MatchIndex match_index;
+
+    // Filled by the EventAssembler, from the derived friend tree if given
+    mutable DerivedKinematics derived;
 };
 
-static const std::map<EventCategory, std::string> event_category_to_label_map = {
-    { kUnknown, "Unknown" },
-    { kSignalCCQE, "Signal (CCQE)" },
-    { kSignalCCMEC, "Signal (CCMEC)" },
-    { kSignalCCRES, "Signal (CCRES)" },
-    { kSignalOther, "Signal (Other)" },
-    { kNuMuCCNhyp, "#nu_{#mu} CCNhyp" },
-    { kNuMuCC0kshrt0hyp, "#nu_{#mu} CC0kshrt0hyp" },
-    { kNuMuCCOther, "Other #nu_{#mu} CC" },
-    { kNC, "NC" },
-    { kOther, "Other" }
+// Indexed by EventCategory
+static const char* const event_category_labels[kNumEventCategories] = {
+    "Unknown",
+    "Signal (CCQE)",
+    "Signal (CCMEC)",
+    "Signal (CCRES)",
+    "Signal (Other)",
+    "#nu_{#mu} CCNhyp",
+    "#nu_{#mu} CC0kshrt0hyp",
+    "Other #nu_{#mu} CC",
+    "NC",
+    "Other"
 };
 
-static const std::map<EventCategory, int> event_category_to_colour_map = {
-    { kUnknown, kGray },
-    { kSignalCCQE, kGreen },
-    { kSignalCCMEC, kGreen + 1 },
-    { kSignalCCRES, kGreen + 2 },
-    { kSignalOther, kGreen + 3 },
-    { kNuMuCCNhyp, kAzure - 2 },
-    { kNuMuCC0kshrt0hyp, kAzure - 1 },
-    { kNuMuCCOther, kAzure },
-    { kNC, kOrange },
-    { kOther, kRed + 3 }
+static const int event_category_colours[kNumEventCategories] = {
+    kGray,
+    kGreen,
+    kGreen + 1,
+    kGreen + 2,
+    kGreen + 3,
+    kAzure - 2,
+    kAzure - 1,
+    kAzure,
+    kOrange,
+    kRed + 3
 };
 
 inline std::string get_event_category_label(EventCategory ec) 
 {
-    auto it = event_category_to_label_map.find(ec);
-    if (it != event_category_to_label_map.end()) {
-        return it->second;
-    }
+    if (ec >= 0 && ec < kNumEventCategories) 
+        return event_category_labels[ec];
     return "Unknown";
 }
 
 inline int get_event_category_colour(EventCategory ec) 
 {
-    auto it = event_category_to_colour_map.find(ec);
-    if (it != event_category_to_colour_map.end()) {
-        return it->second;
-    }
+    if (ec >= 0 && ec < kNumEventCategories) 
+        return event_category_colours[ec];
     return kGray;
 }
 
-inline EventCategory categorise_event(const AnalysisEvent& e) 
+inline bool has_topology(uint32_t topology, uint32_t required, uint32_t vetoed = 0)
+{
+    return (topology & required) == required && !(topology & vetoed);
+}
+
+// One scan of the primary daughters plus the generator-level flags
+inline uint32_t compute_truth_topology(const AnalysisEvent& e)
 {
+    uint32_t topology = 0;
+
     int abs_mc_nu_pdg = std::abs(e.mc_nu_pdg);
-    bool is_mc = (abs_mc_nu_pdg == ELECTRON_NEUTRINO || abs_mc_nu_pdg == MUON_NEUTRINO || abs_mc_nu_pdg == TAU_NEUTRINO);
-    if (!is_mc) 
-        return kUnknown;
+    if (abs_mc_nu_pdg == ELECTRON_NEUTRINO || abs_mc_nu_pdg == MUON_NEUTRINO || abs_mc_nu_pdg == TAU_NEUTRINO) topology |= kTopoNeutrino;
+    if (e.mc_nu_pdg == MUON_NEUTRINO) topology |= kTopoNuMu;
+    if (e.mc_nu_ccnc == CHARGED_CURRENT) topology |= kTopoCC;
+
+    if (e.mc_has_muon) topology |= kTopoMuon;
+    if (e.mc_is_kshort_decay_pionic) topology |= kTopoKShort | kTopoKShortPionic;
+    if (e.mc_has_lambda) topology |= kTopoLambda;
+    if (e.mc_has_sigma_plus) topology |= kTopoSigmaPlus;
+    if (e.mc_has_sigma_minus) topology |= kTopoSigmaMinus;
+    if (e.mc_has_sigma_zero) topology |= kTopoSigmaZero;
+
+    for (int pdg : *e.mc_nu_daughter_pdg) {
+        switch (std::abs(pdg)) {
+        case MUON: topology |= kTopoMuon; break;
+        // A generator-level K0 has not yet become a K0S or K0L, so it may still
+        // give a K0S: count it with the K0S rather than in the no-K0S category
+        case K_SHORT: case K_ZERO: topology |= kTopoKShort | kTopoNeutralKaon; break;
+        case K_LONG: topology |= kTopoNeutralKaon; break;
+        case K_PLUS: topology |= kTopoChargedKaon; break;
+        case LAMBDA: topology |= kTopoLambda; break;
+        case SIGMA_PLUS: topology |= kTopoSigmaPlus; break;
+        case SIGMA_MINUS: topology |= kTopoSigmaMinus; break;
+        case SIGMA_ZERO: topology |= kTopoSigmaZero; break;
+        case PROTON: topology |= kTopoProton; break;
+        case PI_PLUS: topology |= kTopoChargedPion; break;
+        case PI_ZERO: topology |= kTopoPiZero; break;
+        default: break;
+        }
+    }
 
-    bool mc_neutrino_is_numu = (e.mc_nu_pdg == MUON_NEUTRINO);
+    if (topology & (kTopoLambda | kTopoSigmaPlus | kTopoSigmaMinus | kTopoSigmaZero)) topology |= kTopoHyperon;
+
+    return topology;
+}
+
+// Signal is a numu CC event with a muon and a K0S decaying to pi+pi-; other
+// numu CC events split by hyperon content, then by the absence of any K0S
+inline EventCategory categorise_topology(uint32_t topology, int interaction_type)
+{
+    if (!(topology & kTopoNeutrino)) 
+        return kUnknown;
 
-    if (e.mc_nu_ccnc == NEUTRAL_CURRENT) 
+    if (!(topology & kTopoCC)) 
         return kNC;
-    else if (!mc_neutrino_is_numu) 
+    else if (!(topology & kTopoNuMu)) 
         return kOther;
 
-    bool mc_is_signal = mc_neutrino_is_numu;
-    if (mc_is_signal) 
+    if (has_topology(topology, kTopoSignal)) 
     {
-        if (e.mc_nu_interaction_type == 0) 
+        if (interaction_type == 0) 
             return kSignalCCQE;
-        else if (e.mc_nu_interaction_type == 10) 
+        else if (interaction_type == 10) 
             return kSignalCCMEC;
-        else if (e.mc_nu_interaction_type == 1) 
+        else if (interaction_type == 1) 
             return kSignalCCRES;
         else 
             return kSignalOther;
     }
+    else if (topology & kTopoHyperon) 
+        return kNuMuCCNhyp;
+    else if (!(topology & kTopoKShort)) 
+        return kNuMuCC0kshrt0hyp;
     else 
-        return kOther;
-}
\ No newline at end of file
+        return kNuMuCCOther;
+}
+
+inline EventCategory categorise_event(const AnalysisEvent& e) 
+{
+    return categorise_topology(compute_truth_topology(e), e.mc_nu_interaction_type);
+}
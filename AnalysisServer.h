@@ -0,0 +1,328 @@
+#ifndef ANALYSISSERVER_H
+#define ANALYSISSERVER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "ResidentTree.h"
+#include "LruCache.h"
+#include "HistogramAccumulator.h"
+
+// Long-lived process holding the StrangenessSelectionFilter and
+// SliceAnalysis columns in memory. Jobs arrive one line at a time over a
+// Unix socket ("<job> <args...>") and run against the resident columns;
+// selections and histograms they build are kept in an LRU cache so that
+// repeating a study does not redo the work.
+class AnalysisServer
+{
+public:
+    typedef std::vector<std::string> Arguments;
+    typedef std::function<std::string(AnalysisServer&, const Arguments&)> Job;
+
+    AnalysisServer(const std::string& input_name, size_t cache_budget_bytes = size_t(1) << 30)
+        : cache_(cache_budget_bytes)
+    {
+        std::unique_ptr<TFile> file(TFile::Open(input_name.c_str(), "READ"));
+        if (!file || file->IsZombie())
+            throw std::invalid_argument("AnalysisServer: cannot open '" + input_name + "'");
+
+        TTree* events = dynamic_cast<TTree*>(file->Get("emptyselectionfilter/StrangenessSelectionFilter"));
+        TTree* slices = dynamic_cast<TTree*>(file->Get("emptyselectionfilter/SliceAnalysis"));
+        if (!events || !slices)
+            throw std::invalid_argument("AnalysisServer: '" + input_name + "' is missing the analysis trees");
+
+        events_.reset(new ResidentTree(*events));
+        slices_.reset(new ResidentTree(*slices));
+        file->Close();
+
+        register_builtin_jobs();
+
+        std::cout << "AnalysisServer: " << events_->get_num_entries() << " events resident in "
+                  << (events_->get_memory_bytes() + slices_->get_memory_bytes()) / (1024 * 1024) << " MB" << std::endl;
+    }
+
+    // Replaces any job of the same name
+    void register_job(const std::string& name, Job job) { jobs_[name] = job; }
+
+    const ResidentTree& get_events() const { return *events_; }
+    const ResidentTree& get_slices() const { return *slices_; }
+    LruCache<std::string>& get_cache() { return cache_; }
+
+    // Run one request line; failures come back as "error: ..." rather than
+    // taking the server down
+    std::string handle(const std::string& request)
+    {
+        Arguments tokens = tokenise(request);
+        if (tokens.empty()) return "error: empty request";
+
+        auto it = jobs_.find(tokens[0]);
+        if (it == jobs_.end()) return "error: unknown job '" + tokens[0] + "'";
+
+        try {
+            return it->second(*this, Arguments(tokens.begin() + 1, tokens.end()));
+        }
+        catch (const std::exception& ex) {
+            return std::string("error: ") + ex.what();
+        }
+    }
+
+    // Serve until a "shutdown" request
+    void serve(const std::string& socket_path)
+    {
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error("AnalysisServer: cannot create socket");
+
+        sockaddr_un address = make_address(socket_path);
+        unlink(socket_path.c_str());
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 8) < 0) {
+            close(listener);
+            throw std::runtime_error("AnalysisServer: cannot listen on '" + socket_path + "'");
+        }
+
+        std::cout << "AnalysisServer: listening on " << socket_path << std::endl;
+
+        bool running = true;
+        while (running) {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection < 0) continue;
+
+            std::string request = read_line(connection);
+            std::string response;
+            if (request == "shutdown") {
+                response = "ok";
+                running = false;
+            }
+            else {
+                response = handle(request);
+            }
+
+            write_all(connection, response + "\n");
+            close(connection);
+        }
+
+        close(listener);
+        unlink(socket_path.c_str());
+    }
+
+    // Client side: one request, one response
+    static std::string send(const std::string& socket_path, const std::string& request)
+    {
+        int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection < 0) throw std::runtime_error("AnalysisServer: cannot create socket");
+
+        sockaddr_un address = make_address(socket_path);
+        if (connect(connection, (sockaddr*)&address, sizeof(address)) < 0) {
+            close(connection);
+            throw std::runtime_error("AnalysisServer: no server listening on '" + socket_path + "'");
+        }
+
+        write_all(connection, request + "\n");
+
+        std::string response;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(connection, buffer, sizeof(buffer))) > 0) response.append(buffer, n);
+        close(connection);
+
+        if (!response.empty() && response.back() == '\n') response.pop_back();
+        return response;
+    }
+
+    // Entries of the event tree passing comma-separated cuts on scalar
+    // branches, e.g. "mc_has_muon==1,nu_e>0.5"; "all" or "" passes everything
+    std::shared_ptr<const std::vector<int>> select(const std::string& cuts)
+    {
+        return cache_.get_or_compute<std::vector<int>>("select:" + cuts,
+            [&]() {
+                std::vector<Cut> parsed = parse_cuts(cuts);
+                std::shared_ptr<std::vector<int>> selected(new std::vector<int>);
+                for (long long i = 0; i < events_->get_num_entries(); ++i) {
+                    bool pass = true;
+                    for (const Cut& cut : parsed) pass = pass && cut.apply((*cut.column)[i]);
+                    if (pass) selected->push_back(int(i));
+                }
+                return std::shared_ptr<const std::vector<int>>(selected);
+            },
+            [](const std::vector<int>& selected) { return selected.capacity() * sizeof(int); });
+    }
+
+    // A scalar branch fills once per selected event, a vector branch once
+    // per element
+    std::shared_ptr<const Histogram1D> histogram(const std::string& column, int n_bins, double x_min, double x_max, const std::string& cuts = "")
+    {
+        std::ostringstream key;
+        key << "histogram:" << column << ":" << n_bins << ":" << x_min << ":" << x_max << ":" << cuts;
+
+        return cache_.get_or_compute<Histogram1D>(key.str(),
+            [&]() {
+                std::shared_ptr<const std::vector<int>> selected = select(cuts);
+                std::shared_ptr<Histogram1D> hist(new Histogram1D(Binning::uniform(n_bins, x_min, x_max)));
+                if (events_->has_scalar(column)) {
+                    const std::vector<double>& values = events_->get_scalar(column);
+                    for (int i : *selected) hist->fill(values[i]);
+                }
+                else if (events_->has_floats(column)) {
+                    const match_kernels::JaggedBatch<float>& values = events_->get_floats(column);
+                    for (int i : *selected) hist->fill_n(values.event_size(i), values.event_data(i));
+                }
+                else {
+                    const match_kernels::JaggedBatch<int>& values = events_->get_ints(column);
+                    for (int i : *selected) {
+                        for (size_t k = 0; k < values.event_size(i); ++k) hist->fill(values.event_data(i)[k]);
+                    }
+                }
+                return std::shared_ptr<const Histogram1D>(hist);
+            },
+            [](const Histogram1D& hist) { return size_t(hist.get_binning().get_num_bins() + 2) * 3 * sizeof(double); });
+    }
+
+private:
+    struct Cut
+    {
+        const std::vector<double>* column;
+        std::string op;
+        double value;
+
+        bool apply(double x) const
+        {
+            if (op == "<") return x < value;
+            if (op == "<=") return x <= value;
+            if (op == ">") return x > value;
+            if (op == ">=") return x >= value;
+            if (op == "==") return x == value;
+            return x != value;
+        }
+    };
+
+    std::unique_ptr<ResidentTree> events_;
+    std::unique_ptr<ResidentTree> slices_;
+    LruCache<std::string> cache_;
+    std::map<std::string, Job> jobs_;
+
+    std::vector<Cut> parse_cuts(const std::string& cuts) const
+    {
+        std::vector<Cut> parsed;
+        if (cuts.empty() || cuts == "all") return parsed;
+
+        std::stringstream stream(cuts);
+        std::string term;
+        while (std::getline(stream, term, ',')) {
+            size_t pos = term.find_first_of("<>=!");
+            if (pos == std::string::npos || pos == 0)
+                throw std::invalid_argument("AnalysisServer: cannot parse cut '" + term + "'");
+
+            size_t end = pos + 1;
+            if (end < term.size() && term[end] == '=') end++;
+
+            Cut cut;
+            cut.column = &events_->get_scalar(term.substr(0, pos));
+            cut.op = term.substr(pos, end - pos);
+            if (cut.op == "=" || cut.op == "!")
+                throw std::invalid_argument("AnalysisServer: cannot parse cut '" + term + "'");
+            cut.value = std::stod(term.substr(end));
+            parsed.push_back(cut);
+        }
+        return parsed;
+    }
+
+    void register_builtin_jobs()
+    {
+        // count [cuts]
+        register_job("count", [](AnalysisServer& server, const Arguments& args) {
+            return std::to_string(server.select(args.empty() ? "" : args[0])->size());
+        });
+
+        // histogram <column> <n_bins> <x_min> <x_max> [cuts]: one "low_edge content error" line per bin
+        register_job("histogram", [](AnalysisServer& server, const Arguments& args) {
+            if (args.size() < 4)
+                throw std::invalid_argument("usage: histogram <column> <n_bins> <x_min> <x_max> [cuts]");
+
+            std::shared_ptr<const Histogram1D> hist = server.histogram(args[0], std::stoi(args[1]), std::stod(args[2]), std::stod(args[3]),
+                                                                       args.size() > 4 ? args[4] : "");
+            const std::vector<double>& edges = hist->get_binning().get_edges();
+            std::ostringstream out;
+            out << "entries " << hist->get_entries();
+            for (int b = 1; b <= hist->get_binning().get_num_bins(); ++b)
+                out << "\n" << edges[b - 1] << " " << hist->get_bin_content(b) << " " << hist->get_bin_error(b);
+            return out.str();
+        });
+
+        register_job("branches", [](AnalysisServer& server, const Arguments& args) {
+            std::ostringstream out;
+            for (const std::string& name : server.get_events().get_branch_names()) out << name << "\n";
+            return out.str();
+        });
+
+        register_job("stats", [](AnalysisServer& server, const Arguments& args) {
+            LruCache<std::string>& cache = server.get_cache();
+            std::ostringstream out;
+            out << "events " << server.get_events().get_num_entries()
+                << "\nresident_bytes " << server.get_events().get_memory_bytes() + server.get_slices().get_memory_bytes()
+                << "\ncache_entries " << cache.get_num_entries()
+                << "\ncache_bytes " << cache.get_bytes() << " / " << cache.get_budget()
+                << "\ncache_hits " << cache.get_hits()
+                << "\ncache_misses " << cache.get_misses()
+                << "\ncache_evictions " << cache.get_evictions();
+            return out.str();
+        });
+
+        register_job("clear", [](AnalysisServer& server, const Arguments& args) {
+            server.get_cache().clear();
+            return std::string("ok");
+        });
+    }
+
+    static Arguments tokenise(const std::string& request)
+    {
+        Arguments tokens;
+        std::istringstream stream(request);
+        std::string token;
+        while (stream >> token) tokens.push_back(token);
+        return tokens;
+    }
+
+    static sockaddr_un make_address(const std::string& socket_path)
+    {
+        sockaddr_un address = {};
+        if (socket_path.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument("AnalysisServer: socket path too long");
+
+        address.sun_family = AF_UNIX;
+        socket_path.copy(address.sun_path, socket_path.size());
+        return address;
+    }
+
+    static std::string read_line(int connection)
+    {
+        std::string line;
+        char c;
+        while (read(connection, &c, 1) == 1 && c != '\n') line.push_back(c);
+        return line;
+    }
+
+    static void write_all(int connection, const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size()) {
+            // A client that hung up must not kill the server with SIGPIPE
+            ssize_t n = ::send(connection, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            written += size_t(n);
+        }
+    }
+};
+
+#endif // ANALYSISSERVER_H
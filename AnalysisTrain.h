@@ -0,0 +1,190 @@
+#ifndef ANALYSISTRAIN_H
+#define ANALYSISTRAIN_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+#include "AnalysisEvent.h"
+#include "EventAssembler.h"
+#include "EventArena.h"
+
+// One analysis in a train: booked in begin(), fed every event by
+// process(), and finalised (plots, printouts) in end()
+class AnalysisModule
+{
+public:
+    virtual ~AnalysisModule() {}
+
+    virtual std::string get_name() const = 0;
+
+    // Input branches the module reads; an empty list means all of them
+    virtual std::vector<std::string> get_required_branches() const { return {}; }
+
+    // True if process() touches only the module's own state, so it may run
+    // on a worker thread alongside the other modules
+    virtual bool is_independent() const { return false; }
+
+    virtual void begin() {}
+    virtual void process(int entry, const AnalysisEvent& e) = 0;
+    virtual void end() {}
+};
+
+// Runs several modules over a single read pass. Only the union of the
+// modules' branches is read, and independent modules are spread over
+// worker threads that each see every event.
+class AnalysisTrain
+{
+public:
+    AnalysisTrain(int n_threads = 1)
+        : n_threads_(std::max(1, n_threads)), event_(nullptr), entry_(0), generation_(0), pending_(0), stop_(false) {}
+
+    ~AnalysisTrain() { stop_workers(); }
+
+    // The train does not own the modules
+    void add(AnalysisModule& module)
+    {
+        modules_.push_back(&module);
+    }
+
+    std::vector<std::string> get_required_branches() const
+    {
+        std::vector<std::string> branches;
+        for (const AnalysisModule* module : modules_) {
+            std::vector<std::string> required = module->get_required_branches();
+            if (required.empty()) return {};
+            branches.insert(branches.end(), required.begin(), required.end());
+        }
+
+        std::sort(branches.begin(), branches.end());
+        branches.erase(std::unique(branches.begin(), branches.end()), branches.end());
+        return branches;
+    }
+
+    void run(const EventAssembler& assembler, int max_events = -1)
+    {
+        int num_events = assembler.get_num_events();
+        if (max_events >= 0) num_events = std::min(num_events, max_events);
+
+        assembler.set_branch_projection(get_required_branches());
+
+        for (AnalysisModule* module : modules_) module->begin();
+        start_workers();
+
+        for (int i = 0; i < num_events; ++i) {
+            const AnalysisEvent& e = assembler.get_event(i);
+            dispatch(i, e);
+        }
+
+        stop_workers();
+        for (AnalysisModule* module : modules_) module->end();
+
+        assembler.set_branch_projection({});
+
+        std::cout << "AnalysisTrain: " << modules_.size() << " modules over " << num_events << " events" << std::endl;
+    }
+
+private:
+    int n_threads_;
+    std::vector<AnalysisModule*> modules_;
+
+    // Modules run on the calling thread, and one group per worker
+    std::vector<AnalysisModule*> serial_;
+    std::vector<std::vector<AnalysisModule*>> groups_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const AnalysisEvent* event_;
+    int entry_;
+    long generation_;
+    int pending_;
+    bool stop_;
+
+    void start_workers()
+    {
+        serial_.clear();
+        groups_.clear();
+
+        std::vector<AnalysisModule*> independent;
+        for (AnalysisModule* module : modules_) {
+            if (module->is_independent() && n_threads_ > 1) independent.push_back(module);
+            else serial_.push_back(module);
+        }
+
+        int n_workers = std::min(int(independent.size()), n_threads_ - 1);
+        if (n_workers == 0) {
+            serial_ = modules_;
+            return;
+        }
+
+        groups_.resize(n_workers);
+        for (size_t m = 0; m < independent.size(); ++m) groups_[m % n_workers].push_back(independent[m]);
+
+        stop_ = false;
+        generation_ = 0;
+        for (int t = 0; t < n_workers; ++t) workers_.emplace_back(&AnalysisTrain::work, this, t);
+    }
+
+    void stop_workers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (std::thread& worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+    void dispatch(int entry, const AnalysisEvent& e)
+    {
+        if (!workers_.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                event_ = &e;
+                entry_ = entry;
+                pending_ = int(workers_.size());
+                ++generation_;
+            }
+            start_cv_.notify_all();
+        }
+
+        for (AnalysisModule* module : serial_) module->process(entry, e);
+
+        // The event buffer is reused by the next get_event, so wait for every worker
+        if (!workers_.empty()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_cv_.wait(lock, [this] { return pending_ == 0; });
+        }
+    }
+
+    void work(int t)
+    {
+        long seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+
+            seen = generation_;
+            const AnalysisEvent& e = *event_;
+            int entry = entry_;
+            lock.unlock();
+
+            // Each worker has its own arena, so it resets on its own thread
+            EventArena::local().begin_entry(entry);
+            for (AnalysisModule* module : groups_[t]) module->process(entry, e);
+
+            lock.lock();
+            if (--pending_ == 0) done_cv_.notify_one();
+        }
+    }
+};
+
+#endif // ANALYSISTRAIN_H
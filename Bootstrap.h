@@ -0,0 +1,258 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+
+// Poisson(1) bootstrap replica weights from a counter-based generator: the
+// weight of (event, replica) is a pure function of the seed and the event key,
+// so results do not depend on fill order or on how events are split across
+// threads. Accumulators hold all replicas in preallocated arrays and merge.
+class BootstrapWeights
+{
+public:
+    BootstrapWeights(int n_replicas, uint64_t seed = 0)
+        : n_replicas_(n_replicas), seed_(seed), weights_(n_replicas, 1)
+    {
+        if (n_replicas_ <= 0)
+            throw std::invalid_argument("BootstrapWeights: number of replicas must be positive");
+    }
+
+    // Fill the weights of every replica for one event
+    const std::vector<unsigned char>& generate(uint64_t event_key)
+    {
+        uint64_t event_hash = mix(seed_ ^ mix(event_key + 0x9e3779b97f4a7c15ULL));
+        for (int r = 0; r < n_replicas_; ++r) {
+            weights_[r] = poisson_one(mix(event_hash + uint64_t(r) * 0xbf58476d1ce4e5b9ULL));
+        }
+        return weights_;
+    }
+
+    const std::vector<unsigned char>& get() const { return weights_; }
+    int get_num_replicas() const { return n_replicas_; }
+    uint64_t get_seed() const { return seed_; }
+
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // Inverse-CDF draw of Poisson(1) from the top 32 bits of a hash
+    static unsigned char poisson_one(uint64_t bits)
+    {
+        // floor(2^32 * P(k <= n)) for Poisson(1), n = 0..9
+        static const uint32_t cdf[10] = {
+            1580030168u, 3160060337u, 3950075421u, 4213413783u, 4279248373u,
+            4292415291u, 4294609777u, 4294923276u, 4294962463u, 4294966817u
+        };
+
+        uint32_t u = uint32_t(bits >> 32);
+        unsigned char k = 0;
+        while (k < 10 && u >= cdf[k]) ++k;
+        return k;
+    }
+
+private:
+    int n_replicas_;
+    uint64_t seed_;
+    std::vector<unsigned char> weights_;
+};
+
+class BootstrapMean
+{
+public:
+    BootstrapMean(int n_replicas)
+        : n_replicas_(n_replicas), sum_w_(n_replicas, 0.0), sum_wx_(n_replicas, 0.0), n_(0), sum_x_(0.0) {}
+
+    void fill(const BootstrapWeights& weights, double x)
+    {
+        const std::vector<unsigned char>& w = weights.get();
+        for (int r = 0; r < n_replicas_; ++r) {
+            sum_w_[r] += w[r];
+            sum_wx_[r] += w[r] * x;
+        }
+        n_++;
+        sum_x_ += x;
+    }
+
+    void merge(const BootstrapMean& other)
+    {
+        if (other.n_replicas_ != n_replicas_)
+            throw std::invalid_argument("BootstrapMean: cannot merge accumulators with different replica counts");
+
+        for (int r = 0; r < n_replicas_; ++r) {
+            sum_w_[r] += other.sum_w_[r];
+            sum_wx_[r] += other.sum_wx_[r];
+        }
+        n_ += other.n_;
+        sum_x_ += other.sum_x_;
+    }
+
+    double get_mean() const { return (n_ > 0) ? sum_x_ / n_ : 0.0; }
+
+    double get_replica_mean(int r) const { return (sum_w_[r] > 0) ? sum_wx_[r] / sum_w_[r] : get_mean(); }
+
+    // Spread of the replica means about the nominal mean
+    double get_error() const
+    {
+        if (n_replicas_ < 2 || n_ == 0) return 0.0;
+
+        double mean = get_mean();
+        double sum_sq_diff = 0.0;
+        for (int r = 0; r < n_replicas_; ++r) {
+            double diff = get_replica_mean(r) - mean;
+            sum_sq_diff += diff * diff;
+        }
+        return std::sqrt(sum_sq_diff / (n_replicas_ - 1));
+    }
+
+    long get_entries() const { return n_; }
+    int get_num_replicas() const { return n_replicas_; }
+
+private:
+    int n_replicas_;
+    std::vector<double> sum_w_;
+    std::vector<double> sum_wx_;
+    long n_;
+    double sum_x_;
+};
+
+class BootstrapEfficiency
+{
+public:
+    BootstrapEfficiency(int n_replicas)
+        : n_replicas_(n_replicas), passed_(n_replicas, 0), total_(n_replicas, 0), n_passed_(0), n_total_(0) {}
+
+    void fill(const BootstrapWeights& weights, bool passed)
+    {
+        const std::vector<unsigned char>& w = weights.get();
+        for (int r = 0; r < n_replicas_; ++r) {
+            total_[r] += w[r];
+        }
+        if (passed) {
+            for (int r = 0; r < n_replicas_; ++r) {
+                passed_[r] += w[r];
+            }
+            n_passed_++;
+        }
+        n_total_++;
+    }
+
+    void merge(const BootstrapEfficiency& other)
+    {
+        if (other.n_replicas_ != n_replicas_)
+            throw std::invalid_argument("BootstrapEfficiency: cannot merge accumulators with different replica counts");
+
+        for (int r = 0; r < n_replicas_; ++r) {
+            passed_[r] += other.passed_[r];
+            total_[r] += other.total_[r];
+        }
+        n_passed_ += other.n_passed_;
+        n_total_ += other.n_total_;
+    }
+
+    double get_efficiency() const { return (n_total_ > 0) ? double(n_passed_) / n_total_ : 0.0; }
+
+    double get_replica_efficiency(int r) const { return (total_[r] > 0) ? double(passed_[r]) / total_[r] : get_efficiency(); }
+
+    double get_error() const
+    {
+        if (n_replicas_ < 2 || n_total_ == 0) return 0.0;
+
+        double efficiency = get_efficiency();
+        double sum_sq_diff = 0.0;
+        for (int r = 0; r < n_replicas_; ++r) {
+            double diff = get_replica_efficiency(r) - efficiency;
+            sum_sq_diff += diff * diff;
+        }
+        return std::sqrt(sum_sq_diff / (n_replicas_ - 1));
+    }
+
+    long get_num_passed() const { return n_passed_; }
+    long get_num_total() const { return n_total_; }
+
+private:
+    int n_replicas_;
+    std::vector<long> passed_;
+    std::vector<long> total_;
+    long n_passed_;
+    long n_total_;
+};
+
+// Uniformly binned counts for every replica; bin 0 is underflow and
+// bin n_bins + 1 is overflow, as in ROOT. Replicas of a bin are contiguous.
+class BootstrapHistogram
+{
+public:
+    BootstrapHistogram(int n_bins, double x_min, double x_max, int n_replicas)
+        : n_bins_(n_bins), x_min_(x_min), x_max_(x_max), n_replicas_(n_replicas),
+          inv_width_(n_bins / (x_max - x_min)),
+          counts_(size_t(n_bins + 2) * n_replicas, 0.0), nominal_(n_bins + 2, 0.0) {}
+
+    int find_bin(double x) const
+    {
+        if (!(x >= x_min_)) return 0;
+        if (x >= x_max_) return n_bins_ + 1;
+        int bin = 1 + int((x - x_min_) * inv_width_);
+        return (bin > n_bins_) ? n_bins_ : bin;
+    }
+
+    void fill(const BootstrapWeights& weights, double x, double event_weight = 1.0)
+    {
+        const std::vector<unsigned char>& w = weights.get();
+        int bin = find_bin(x);
+        double* counts = &counts_[size_t(bin) * n_replicas_];
+        for (int r = 0; r < n_replicas_; ++r) {
+            counts[r] += w[r] * event_weight;
+        }
+        nominal_[bin] += event_weight;
+    }
+
+    void merge(const BootstrapHistogram& other)
+    {
+        if (other.n_bins_ != n_bins_ || other.n_replicas_ != n_replicas_ || other.x_min_ != x_min_ || other.x_max_ != x_max_)
+            throw std::invalid_argument("BootstrapHistogram: cannot merge histograms with different binning");
+
+        for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        for (size_t i = 0; i < nominal_.size(); ++i) nominal_[i] += other.nominal_[i];
+    }
+
+    double get_bin_content(int bin) const { return nominal_[bin]; }
+
+    double get_replica_bin_content(int bin, int r) const { return counts_[size_t(bin) * n_replicas_ + r]; }
+
+    double get_bin_error(int bin) const
+    {
+        if (n_replicas_ < 2) return 0.0;
+
+        double nominal = nominal_[bin];
+        const double* counts = &counts_[size_t(bin) * n_replicas_];
+        double sum_sq_diff = 0.0;
+        for (int r = 0; r < n_replicas_; ++r) {
+            double diff = counts[r] - nominal;
+            sum_sq_diff += diff * diff;
+        }
+        return std::sqrt(sum_sq_diff / (n_replicas_ - 1));
+    }
+
+    int get_num_bins() const { return n_bins_; }
+    double get_x_min() const { return x_min_; }
+    double get_x_max() const { return x_max_; }
+
+private:
+    int n_bins_;
+    double x_min_, x_max_;
+    int n_replicas_;
+    double inv_width_;
+    std::vector<double> counts_;
+    std::vector<double> nominal_;
+};
+
+#endif // BOOTSTRAP_H
@@ -0,0 +1,143 @@
+#ifndef CATEGORYHISTOGRAMS_H
+#define CATEGORYHISTOGRAMS_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+
+#include "TH1D.h"
+#include "THStack.h"
+#include "TCanvas.h"
+#include "TLegend.h"
+
+#include "AnalysisEvent.h"
+#include "PlotFunctions.h"
+
+// One histogram per EventCategory for each declared variable, all filled in
+// a single pass: the event's category indexes straight into the set, so a
+// full category breakdown costs one loop rather than one per category.
+class CategoryHistograms
+{
+public:
+    typedef std::function<double(const AnalysisEvent&)> Variable;
+
+    CategoryHistograms(const std::string& name) : name_(name) {}
+
+    void add_variable(const std::string& name, const std::string& title, int n_bins, double x_min, double x_max, Variable variable)
+    {
+        for (const HistogramSet& set : sets_) {
+            if (set.name == name)
+                throw std::invalid_argument("CategoryHistograms: variable '" + name + "' is already defined");
+        }
+
+        HistogramSet set;
+        set.name = name;
+        set.title = title;
+        set.variable = variable;
+        for (int c = 0; c < kNumEventCategories; ++c) {
+            std::string hist_name = name_ + "_" + name + "_" + std::to_string(c);
+            set.hists[c].reset(new TH1D(hist_name.c_str(), title.c_str(), n_bins, x_min, x_max));
+            set.hists[c]->SetDirectory(nullptr);
+        }
+        sets_.push_back(std::move(set));
+    }
+
+    void fill(const AnalysisEvent& e, double w = 1.0)
+    {
+        int c = (e.category >= 0 && e.category < kNumEventCategories) ? e.category : kUnknown;
+        for (HistogramSet& set : sets_) {
+            set.hists[c]->Fill(set.variable(e), w);
+        }
+    }
+
+    void merge(const CategoryHistograms& other)
+    {
+        if (other.sets_.size() != sets_.size())
+            throw std::invalid_argument("CategoryHistograms: cannot merge sets with different variables");
+
+        for (size_t v = 0; v < sets_.size(); ++v) {
+            if (other.sets_[v].name != sets_[v].name)
+                throw std::invalid_argument("CategoryHistograms: cannot merge sets with different variables");
+            for (int c = 0; c < kNumEventCategories; ++c) sets_[v].hists[c]->Add(other.sets_[v].hists[c].get());
+        }
+    }
+
+    TH1D* get_histogram(const std::string& variable, EventCategory category) const
+    {
+        return get_set(variable).hists[category].get();
+    }
+
+    // Stacked by category in enum order, with signal drawn at the bottom
+    void plot_stacked(const std::string& variable, const std::string& plotdir) const
+    {
+        const HistogramSet& set = get_set(variable);
+
+        TCanvas* c = new TCanvas("c", "c", plot_functions::single_canvas_x, plot_functions::single_canvas_y);
+        THStack* stack = new THStack((name_ + "_" + set.name + "_stack").c_str(), set.title.c_str());
+        TLegend* legend = new TLegend(0.55, 0.55, 0.88, 0.88);
+        legend->SetBorderSize(0);
+        legend->SetFillStyle(0);
+
+        for (int cat = 0; cat < kNumEventCategories; ++cat) {
+            TH1D* hist = set.hists[cat].get();
+            if (hist->GetEntries() == 0) continue;
+
+            int colour = get_event_category_colour(EventCategory(cat));
+            hist->SetFillColor(colour);
+            hist->SetLineColor(colour);
+            stack->Add(hist, "HIST");
+            legend->AddEntry(hist, get_event_category_label(EventCategory(cat)).c_str(), "f");
+        }
+
+        stack->Draw();
+        stack->GetXaxis()->SetTitleSize(plot_functions::single_xaxis_title_size);
+        stack->GetYaxis()->SetTitleSize(plot_functions::single_yaxis_title_size);
+        stack->GetXaxis()->SetTitleOffset(plot_functions::single_xaxis_title_offset);
+        stack->GetYaxis()->SetTitleOffset(plot_functions::single_yaxis_title_offset);
+        stack->GetXaxis()->SetLabelSize(plot_functions::single_xaxis_label_size);
+        stack->GetYaxis()->SetLabelSize(plot_functions::single_yaxis_label_size);
+        legend->Draw();
+
+        c->SaveAs((plotdir + "/" + name_ + "_" + set.name + "_stacked.pdf").c_str());
+
+        delete legend;
+        delete stack;
+        delete c;
+    }
+
+    void plot_all_stacked(const std::string& plotdir) const
+    {
+        for (const HistogramSet& set : sets_) plot_stacked(set.name, plotdir);
+    }
+
+    std::vector<std::string> get_variable_names() const
+    {
+        std::vector<std::string> names;
+        for (const HistogramSet& set : sets_) names.push_back(set.name);
+        return names;
+    }
+
+private:
+    struct HistogramSet
+    {
+        std::string name;
+        std::string title;
+        Variable variable;
+        std::unique_ptr<TH1D> hists[kNumEventCategories];
+    };
+
+    std::string name_;
+    std::vector<HistogramSet> sets_;
+
+    const HistogramSet& get_set(const std::string& variable) const
+    {
+        for (const HistogramSet& set : sets_) {
+            if (set.name == variable) return set;
+        }
+        throw std::invalid_argument("CategoryHistograms: unknown variable '" + variable + "'");
+    }
+};
+
+#endif // CATEGORYHISTOGRAMS_H
@@ -0,0 +1,434 @@
+#ifndef COMPRESSEDTABLE_H
+#define COMPRESSEDTABLE_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "TTree.h"
+
+#include "ResidentTree.h"
+#include "StringDictionary.h"
+
+// One column of numbers stored in the smallest encoding that fits it:
+// integers as an offset plus a bit-packed difference, or as bit-packed
+// codes into a dictionary when only a few distinct values occur (PDG
+// codes); floats as float or double, or as fixed point when the caller
+// accepts a given precision. Values are decoded a block at a time.
+class CompressedColumn
+{
+public:
+    enum Encoding { kFloat, kDouble, kBitPacked, kDictionary, kFixedPoint };
+
+    static constexpr size_t kBlockSize = 1024;
+
+    CompressedColumn() : encoding_(kDouble), n_(0), width_(0), offset_(0.0), scale_(1.0) {}
+
+    // Lossless unless precision > 0, which allows fixed point with that
+    // step (error at most precision / 2)
+    static CompressedColumn encode(const std::vector<double>& values, double precision = 0)
+    {
+        CompressedColumn column;
+        column.n_ = values.size();
+
+        bool finite = true, integral = true, float_exact = true;
+        double min = 0, max = 0;
+        for (size_t i = 0; i < values.size(); ++i) {
+            double x = values[i];
+            if (!std::isfinite(x)) {
+                finite = false;
+                integral = false;
+            }
+            else if (x != std::floor(x) || std::fabs(x) > 9007199254740992.0) {
+                integral = false;
+            }
+            if (double(float(x)) != x && !std::isnan(x)) float_exact = false;
+            if (i == 0 || x < min) min = x;
+            if (i == 0 || x > max) max = x;
+        }
+
+        if (integral) {
+            int range_width = bit_width(uint64_t(max - min));
+
+            std::vector<double> dictionary(values);
+            std::sort(dictionary.begin(), dictionary.end());
+            dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+            int dictionary_width = dictionary.empty() ? 0 : bit_width(dictionary.size() - 1);
+
+            size_t range_bytes = values.size() * range_width / 8;
+            size_t dictionary_bytes = values.size() * dictionary_width / 8 + dictionary.size() * sizeof(double);
+
+            bool range_fits = range_width <= kMaxWidth;
+            if (dictionary_width <= kMaxWidth && (!range_fits || dictionary_bytes < range_bytes) &&
+                dictionary_bytes < values.size() * sizeof(double)) {
+                column.encoding_ = kDictionary;
+                column.width_ = dictionary_width;
+                std::vector<uint32_t> codes(values.size());
+                for (size_t i = 0; i < values.size(); ++i)
+                    codes[i] = uint32_t(std::lower_bound(dictionary.begin(), dictionary.end(), values[i]) - dictionary.begin());
+                column.dictionary_ = dictionary;
+                column.pack(codes);
+                return column;
+            }
+            if (range_fits) {
+                column.encoding_ = kBitPacked;
+                column.width_ = range_width;
+                column.offset_ = min;
+                std::vector<uint32_t> codes(values.size());
+                for (size_t i = 0; i < values.size(); ++i) codes[i] = uint32_t(values[i] - min);
+                column.pack(codes);
+                return column;
+            }
+        }
+        else if (precision > 0 && finite) {
+            int width = bit_width(uint64_t(std::llround((max - min) / precision)));
+            if (width <= kMaxWidth) {
+                column.encoding_ = kFixedPoint;
+                column.width_ = width;
+                column.offset_ = min;
+                column.scale_ = precision;
+                std::vector<uint32_t> codes(values.size());
+                for (size_t i = 0; i < values.size(); ++i) codes[i] = uint32_t(std::llround((values[i] - min) / precision));
+                column.pack(codes);
+                return column;
+            }
+        }
+
+        if (float_exact) {
+            column.encoding_ = kFloat;
+            column.floats_.assign(values.begin(), values.end());
+        }
+        else {
+            column.encoding_ = kDouble;
+            column.doubles_ = values;
+        }
+        return column;
+    }
+
+    size_t size() const { return n_; }
+    Encoding get_encoding() const { return encoding_; }
+    int get_bit_width() const { return width_; }
+
+    size_t get_memory_bytes() const
+    {
+        return words_.capacity() * sizeof(uint64_t) + dictionary_.capacity() * sizeof(double) +
+               floats_.capacity() * sizeof(float) + doubles_.capacity() * sizeof(double);
+    }
+
+    double get(size_t i) const
+    {
+        double value;
+        decode(i, 1, &value);
+        return value;
+    }
+
+    // Codes are unpacked into a block buffer and mapped in a second,
+    // branch-free loop, so both loops vectorise
+    void decode(size_t first, size_t n, double* out) const
+    {
+        if (first + n > n_)
+            throw std::invalid_argument("CompressedColumn: decode past the end of the column");
+
+        if (encoding_ == kFloat) {
+            for (size_t k = 0; k < n; ++k) out[k] = floats_[first + k];
+            return;
+        }
+        if (encoding_ == kDouble) {
+            std::copy(doubles_.begin() + first, doubles_.begin() + first + n, out);
+            return;
+        }
+
+        uint32_t codes[kBlockSize];
+        for (size_t start = 0; start < n; start += kBlockSize) {
+            size_t m = std::min(kBlockSize, n - start);
+            unpack(first + start, m, codes);
+
+            double* block = out + start;
+            if (encoding_ == kDictionary) {
+                const double* dictionary = dictionary_.data();
+                for (size_t k = 0; k < m; ++k) block[k] = dictionary[codes[k]];
+            }
+            else {
+                for (size_t k = 0; k < m; ++k) block[k] = offset_ + codes[k] * scale_;
+            }
+        }
+    }
+
+    // Raw codes, e.g. to compare dictionary entries without decoding
+    void decode_codes(size_t first, size_t n, uint32_t* out) const
+    {
+        if (encoding_ != kBitPacked && encoding_ != kDictionary && encoding_ != kFixedPoint)
+            throw std::invalid_argument("CompressedColumn: column is not bit-packed");
+        if (first + n > n_)
+            throw std::invalid_argument("CompressedColumn: decode past the end of the column");
+        unpack(first, n, out);
+    }
+
+    static const char* get_encoding_name(Encoding encoding)
+    {
+        static const char* names[] = {"float", "double", "bit-packed", "dictionary", "fixed-point"};
+        return names[encoding];
+    }
+
+private:
+    static constexpr int kMaxWidth = 32;
+
+    Encoding encoding_;
+    size_t n_;
+    int width_;
+    double offset_;
+    double scale_;
+    std::vector<uint64_t> words_;
+    std::vector<double> dictionary_;
+    std::vector<float> floats_;
+    std::vector<double> doubles_;
+
+    static int bit_width(uint64_t x)
+    {
+        int width = 0;
+        while (x) {
+            width++;
+            x >>= 1;
+        }
+        return width;
+    }
+
+    // Code i occupies bits [i * width, (i + 1) * width); one spare word lets
+    // unpack read two words unconditionally
+    void pack(const std::vector<uint32_t>& codes)
+    {
+        words_.assign(std::max<size_t>(2, (codes.size() * width_ + 63) / 64 + 1), 0);
+        for (size_t i = 0; i < codes.size(); ++i) {
+            size_t bit = i * width_;
+            size_t word = bit >> 6;
+            int shift = int(bit & 63);
+            words_[word] |= uint64_t(codes[i]) << shift;
+            if (shift + width_ > 64) words_[word + 1] |= uint64_t(codes[i]) >> (64 - shift);
+        }
+    }
+
+    void unpack(size_t first, size_t n, uint32_t* out) const
+    {
+        const uint64_t mask = (uint64_t(1) << width_) - 1;
+        const uint64_t* words = words_.data();
+        for (size_t k = 0; k < n; ++k) {
+            size_t bit = (first + k) * width_;
+            size_t word = bit >> 6;
+            int shift = int(bit & 63);
+            // The second shift is split so a zero shift stays defined; the
+            // stray high bit it leaves is above any width and masked away
+            uint64_t value = (words[word] >> shift) | ((words[word + 1] << 1) << (63 - shift));
+            out[k] = uint32_t(value & mask);
+        }
+    }
+};
+
+// Dictionary-encoded strings, e.g. Geant4 end processes
+class StringColumn
+{
+public:
+    void append(const std::string& value)
+    {
+        pending_.push_back(dictionary_.intern(value));
+    }
+
+    // Pack the appended codes; call once after the last append
+    void finish()
+    {
+        std::vector<double> codes(pending_.begin(), pending_.end());
+        codes_ = CompressedColumn::encode(codes);
+        pending_.clear();
+        pending_.shrink_to_fit();
+    }
+
+    size_t size() const { return codes_.size(); }
+    const std::string& get(size_t i) const { return dictionary_.get(get_code(i)); }
+
+    uint32_t get_code(size_t i) const { return uint32_t(codes_.get(i)); }
+
+    // Code of a string, or -1 if it never occurs
+    long find_code(const std::string& value) const { return dictionary_.find(value); }
+
+    const CompressedColumn& get_codes() const { return codes_; }
+    const StringDictionary& get_dictionary() const { return dictionary_; }
+
+    size_t get_memory_bytes() const { return codes_.get_memory_bytes() + dictionary_.get_memory_bytes(); }
+
+private:
+    StringDictionary dictionary_;
+    std::vector<uint32_t> pending_;
+    CompressedColumn codes_;
+};
+
+// Element values of a vector branch plus per-event offsets
+struct JaggedColumn
+{
+    CompressedColumn values;
+    std::vector<int> offsets;
+
+    size_t event_size(size_t e) const { return size_t(offsets[e + 1] - offsets[e]); }
+};
+
+// A whole tree held in memory in compressed columns. Branches are read
+// one at a time, so at most one column is ever held uncompressed.
+class CompressedTable
+{
+public:
+    typedef std::function<void(size_t first, size_t n, const double* values)> BlockFunction;
+
+    // Branches listed in fixed_point are stored to the given precision
+    // (e.g. 0.01 cm for coordinates); everything else is lossless. An empty
+    // branch list loads every supported branch.
+    CompressedTable(TTree& tree, const std::map<std::string, double>& fixed_point = {}, const std::vector<std::string>& branches = {})
+        : num_entries_(tree.GetEntries())
+    {
+        TObjArray* list = tree.GetListOfBranches();
+        for (int b = 0; list && b < list->GetEntries(); ++b) {
+            TBranch* branch = dynamic_cast<TBranch*>(list->At(b));
+            if (!branch) continue;
+
+            std::string name = branch->GetName();
+            if (!branches.empty() && std::find(branches.begin(), branches.end(), name) == branches.end()) continue;
+
+            ResidentTree::Slot slot = ResidentTree::classify(*branch);
+            if (slot.kind == ResidentTree::kUnsupported) continue;
+            slot.name = name;
+
+            auto precision = fixed_point.find(name);
+            load(tree, slot, precision == fixed_point.end() ? 0.0 : precision->second);
+        }
+
+        tree.ResetBranchAddresses();
+        tree.SetBranchStatus("*", true);
+    }
+
+    long long get_num_entries() const { return num_entries_; }
+
+    bool has_scalar(const std::string& name) const { return scalars_.count(name) > 0; }
+    bool has_jagged(const std::string& name) const { return jagged_.count(name) > 0; }
+    bool has_strings(const std::string& name) const { return strings_.count(name) > 0; }
+
+    const CompressedColumn& get_scalar(const std::string& name) const { return find(scalars_, name); }
+    const JaggedColumn& get_jagged(const std::string& name) const { return find(jagged_, name); }
+    const StringColumn& get_strings(const std::string& name) const { return find(strings_, name); }
+
+    // Decode a scalar column block by block; first is the entry of values[0]
+    void scan(const std::string& name, BlockFunction function) const
+    {
+        scan_column(get_scalar(name), function);
+    }
+
+    // Same over the flattened elements of a vector branch
+    void scan_elements(const std::string& name, BlockFunction function) const
+    {
+        scan_column(get_jagged(name).values, function);
+    }
+
+    size_t get_memory_bytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& column : scalars_) bytes += column.second.get_memory_bytes();
+        for (const auto& column : jagged_) bytes += column.second.values.get_memory_bytes() + column.second.offsets.capacity() * sizeof(int);
+        for (const auto& column : strings_) bytes += column.second.get_memory_bytes();
+        return bytes;
+    }
+
+    void print_summary() const
+    {
+        std::cout << std::left << std::setw(40) << "Column" << std::setw(14) << "Encoding" << std::setw(8) << "Bits" << "Bytes" << std::endl;
+        for (const auto& column : scalars_) print_row(column.first, column.second);
+        for (const auto& column : jagged_) print_row(column.first + "[]", column.second.values);
+        for (const auto& column : strings_) print_row(column.first, column.second.get_codes());
+        std::cout << "Total: " << get_memory_bytes() << " bytes for " << num_entries_ << " entries" << std::endl;
+    }
+
+private:
+    long long num_entries_;
+    std::map<std::string, CompressedColumn> scalars_;
+    std::map<std::string, JaggedColumn> jagged_;
+    std::map<std::string, StringColumn> strings_;
+
+    void load(TTree& tree, ResidentTree::Slot& slot, double precision)
+    {
+        tree.SetBranchStatus("*", false);
+        tree.SetBranchStatus(slot.name.c_str(), true);
+
+        std::vector<double> values;
+        std::vector<int> offsets = {0};
+        StringColumn strings;
+
+        if (slot.kind == ResidentTree::kScalar) tree.SetBranchAddress(slot.name.c_str(), (void*)&slot.buffer);
+        else if (slot.kind == ResidentTree::kFloatVector) tree.SetBranchAddress(slot.name.c_str(), &slot.floats);
+        else if (slot.kind == ResidentTree::kIntVector) tree.SetBranchAddress(slot.name.c_str(), &slot.ints);
+        else tree.SetBranchAddress(slot.name.c_str(), &slot.text);
+
+        for (long long i = 0; i < num_entries_; ++i) {
+            tree.GetEntry(i);
+            if (slot.kind == ResidentTree::kScalar) {
+                values.push_back(slot.to_double());
+            }
+            else if (slot.kind == ResidentTree::kFloatVector) {
+                values.insert(values.end(), slot.floats->begin(), slot.floats->end());
+                offsets.push_back(int(values.size()));
+            }
+            else if (slot.kind == ResidentTree::kIntVector) {
+                values.insert(values.end(), slot.ints->begin(), slot.ints->end());
+                offsets.push_back(int(values.size()));
+            }
+            else {
+                strings.append(*slot.text);
+            }
+        }
+
+        tree.ResetBranchAddresses();
+        delete slot.floats;
+        delete slot.ints;
+        delete slot.text;
+
+        if (slot.kind == ResidentTree::kScalar) {
+            scalars_[slot.name] = CompressedColumn::encode(values, precision);
+        }
+        else if (slot.kind == ResidentTree::kString) {
+            strings.finish();
+            strings_[slot.name] = std::move(strings);
+        }
+        else {
+            JaggedColumn& column = jagged_[slot.name];
+            column.values = CompressedColumn::encode(values, precision);
+            column.offsets = std::move(offsets);
+        }
+    }
+
+    static void scan_column(const CompressedColumn& column, BlockFunction function)
+    {
+        double block[CompressedColumn::kBlockSize];
+        for (size_t first = 0; first < column.size(); first += CompressedColumn::kBlockSize) {
+            size_t n = std::min(CompressedColumn::kBlockSize, column.size() - first);
+            column.decode(first, n, block);
+            function(first, n, block);
+        }
+    }
+
+    static void print_row(const std::string& name, const CompressedColumn& column)
+    {
+        std::cout << std::left << std::setw(40) << name << std::setw(14) << CompressedColumn::get_encoding_name(column.get_encoding())
+                  << std::setw(8) << column.get_bit_width() << column.get_memory_bytes() << std::endl;
+    }
+
+    template <typename C> static const typename C::mapped_type& find(const C& columns, const std::string& name)
+    {
+        auto it = columns.find(name);
+        if (it == columns.end())
+            throw std::invalid_argument("CompressedTable: no column '" + name + "'");
+        return it->second;
+    }
+};
+
+#endif // COMPRESSEDTABLE_H
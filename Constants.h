@@ -17,6 +17,14 @@ constexpr int TAU_NEUTRINO = 16;
 constexpr int PROTON = 2212;
 constexpr int PI_ZERO = 111;
 constexpr int PI_PLUS = 211;
+constexpr int K_LONG = 130;
+constexpr int K_SHORT = 310;
+constexpr int K_ZERO = 311;
+constexpr int K_PLUS = 321;
+constexpr int LAMBDA = 3122;
+constexpr int SIGMA_PLUS = 3222;
+constexpr int SIGMA_ZERO = 3212;
+constexpr int SIGMA_MINUS = 3112;
 
 constexpr float DEFAULT_PROTON_PID_CUT = 0.2;
 constexpr float LEAD_P_MIN_MOM_CUT = 0.250; // GeV/c
@@ -29,6 +37,8 @@ constexpr float MUON_MOM_QUALITY_CUT = 0.25; // fractional difference
 constexpr float TOPO_SCORE_CUT = 0.1;
 constexpr float COSMIC_IP_CUT = 10.; // cm
 
+constexpr float WIRE_PITCH = 0.3; // cm
+
 constexpr float MUON_TRACK_SCORE_CUT = 0.8;
 constexpr float MUON_VTX_DISTANCE_CUT = 4.; // cm
 constexpr float MUON_LENGTH_CUT = 10.; // cm
@@ -36,6 +46,9 @@ constexpr float MUON_PID_CUT = 0.2;
 
 constexpr float TRACK_SCORE_CUT = 0.5;
 
+constexpr float PFP_MATCH_PURITY_CUT = 0.5;
+constexpr float PFP_MATCH_COMPLETENESS_CUT = 0.1;
+
 constexpr double PCV_X_MIN = 10.;
 constexpr double PCV_X_MAX = 246.35;
 
@@ -0,0 +1,196 @@
+#ifndef DERIVEDCOLUMNENGINE_H
+#define DERIVEDCOLUMNENGINE_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "Constants.h"
+#include "AnalysisEvent.h"
+#include "DerivedKinematics.h"
+
+// Computes a declared set of derived columns over a batch of events. The
+// inputs are gathered into one array per branch and every column is a
+// single loop over those arrays, instead of building TVector3 temporaries
+// per event inside each macro. A single event goes through the same
+// kernels with a batch of one.
+class DerivedColumnEngine
+{
+public:
+    DerivedColumnEngine(const std::vector<DerivedColumn>& columns = all_derived_columns())
+        : columns_(columns), n_(0) {}
+
+    void add(const AnalysisEvent& e)
+    {
+        float row[kNumInputs];
+        gather(e, row);
+        for (int k = 0; k < kNumInputs; ++k) inputs_[k].push_back(row[k]);
+        n_++;
+    }
+
+    void compute()
+    {
+        const float* in[kNumInputs];
+        for (int k = 0; k < kNumInputs; ++k) in[k] = inputs_[k].data();
+
+        for (DerivedColumn c : columns_) {
+            outputs_[c].resize(n_);
+            compute_column(c, in, n_, outputs_[c].data());
+        }
+    }
+
+    void clear()
+    {
+        for (int k = 0; k < kNumInputs; ++k) inputs_[k].clear();
+        for (int c = 0; c < kNumDerivedColumns; ++c) outputs_[c].clear();
+        n_ = 0;
+    }
+
+    size_t get_num_events() const { return n_; }
+    const std::vector<DerivedColumn>& get_columns() const { return columns_; }
+
+    // Valid after compute() for the declared columns
+    const std::vector<float>& get_column(DerivedColumn c) const { return outputs_[c]; }
+    float get(DerivedColumn c, size_t i) const { return outputs_[c][i]; }
+
+    static void compute_event(const AnalysisEvent& e, const std::vector<DerivedColumn>& columns, DerivedKinematics& derived)
+    {
+        float row[kNumInputs];
+        gather(e, row);
+
+        const float* in[kNumInputs];
+        for (int k = 0; k < kNumInputs; ++k) in[k] = &row[k];
+
+        for (DerivedColumn c : columns) compute_column(c, in, 1, &derived.values[c]);
+    }
+
+private:
+    enum Input
+    {
+        kMuonPx, kMuonPy, kMuonPz, kMuonEnergy,
+        kMuonStartX, kMuonStartY, kMuonStartZ,
+        kPiPlusPx, kPiPlusPy, kPiPlusPz,
+        kPiPlusStartX, kPiPlusStartY, kPiPlusStartZ,
+        kPiMinusPx, kPiMinusPy, kPiMinusPz,
+        kPiMinusStartX, kPiMinusStartY, kPiMinusStartZ,
+        kKShortEndX, kKShortEndY, kKShortEndZ,
+        kNuVtxX, kNuVtxY, kNuVtxZ,
+        kRecoVtxX, kRecoVtxY, kRecoVtxZ,
+        kNumInputs
+    };
+
+    std::vector<DerivedColumn> columns_;
+    std::vector<float> inputs_[kNumInputs];
+    std::vector<float> outputs_[kNumDerivedColumns];
+    size_t n_;
+
+    static void gather(const AnalysisEvent& e, float* row)
+    {
+        row[kMuonPx] = e.mc_muon_px;
+        row[kMuonPy] = e.mc_muon_py;
+        row[kMuonPz] = e.mc_muon_pz;
+        row[kMuonEnergy] = e.mc_muon_energy;
+        row[kMuonStartX] = e.mc_muon_startx;
+        row[kMuonStartY] = e.mc_muon_starty;
+        row[kMuonStartZ] = e.mc_muon_startz;
+        row[kPiPlusPx] = e.mc_kshrt_piplus_px;
+        row[kPiPlusPy] = e.mc_kshrt_piplus_py;
+        row[kPiPlusPz] = e.mc_kshrt_piplus_pz;
+        row[kPiPlusStartX] = e.mc_kshrt_piplus_startx;
+        row[kPiPlusStartY] = e.mc_kshrt_piplus_starty;
+        row[kPiPlusStartZ] = e.mc_kshrt_piplus_startz;
+        row[kPiMinusPx] = e.mc_kshrt_piminus_px;
+        row[kPiMinusPy] = e.mc_kshrt_piminus_py;
+        row[kPiMinusPz] = e.mc_kshrt_piminus_pz;
+        row[kPiMinusStartX] = e.mc_kshrt_piminus_startx;
+        row[kPiMinusStartY] = e.mc_kshrt_piminus_starty;
+        row[kPiMinusStartZ] = e.mc_kshrt_piminus_startz;
+        row[kKShortEndX] = e.mc_kshrt_endx;
+        row[kKShortEndY] = e.mc_kshrt_endy;
+        row[kKShortEndZ] = e.mc_kshrt_endz;
+        row[kNuVtxX] = e.mc_nu_vtx_x;
+        row[kNuVtxY] = e.mc_nu_vtx_y;
+        row[kNuVtxZ] = e.mc_nu_vtx_z;
+        row[kRecoVtxX] = e.nu_vtx_x;
+        row[kRecoVtxY] = e.nu_vtx_y;
+        row[kRecoVtxZ] = e.nu_vtx_z;
+    }
+
+    static void magnitude(const float* x, const float* y, const float* z, size_t n, float* out)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+    }
+
+    static void distance(const float* const* in, int a, int b, size_t n, float* out)
+    {
+        const float *ax = in[a], *ay = in[a + 1], *az = in[a + 2];
+        const float *bx = in[b], *by = in[b + 1], *bz = in[b + 2];
+        for (size_t i = 0; i < n; ++i) {
+            float dx = ax[i] - bx[i], dy = ay[i] - by[i], dz = az[i] - bz[i];
+            out[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+
+    static void compute_column(DerivedColumn c, const float* const* in, size_t n, float* out)
+    {
+        switch (c) {
+        case kMuonMomentum:
+            magnitude(in[kMuonPx], in[kMuonPy], in[kMuonPz], n, out);
+            break;
+        case kPiPlusMomentum:
+            magnitude(in[kPiPlusPx], in[kPiPlusPy], in[kPiPlusPz], n, out);
+            break;
+        case kPiMinusMomentum:
+            magnitude(in[kPiMinusPx], in[kPiMinusPy], in[kPiMinusPz], n, out);
+            break;
+        case kPiPiOpeningAngle:
+            // As TVector3::Angle: zero if either momentum vanishes
+            for (size_t i = 0; i < n; ++i) {
+                double ax = in[kPiPlusPx][i], ay = in[kPiPlusPy][i], az = in[kPiPlusPz][i];
+                double bx = in[kPiMinusPx][i], by = in[kPiMinusPy][i], bz = in[kPiMinusPz][i];
+                double norm = std::sqrt((ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz));
+                double cosine = (norm > 0) ? (ax * bx + ay * by + az * bz) / norm : 1.0;
+                out[i] = float(std::acos(std::min(1.0, std::max(-1.0, cosine))));
+            }
+            break;
+        case kPiPiInvariantMass:
+            for (size_t i = 0; i < n; ++i) {
+                double ax = in[kPiPlusPx][i], ay = in[kPiPlusPy][i], az = in[kPiPlusPz][i];
+                double bx = in[kPiMinusPx][i], by = in[kPiMinusPy][i], bz = in[kPiMinusPz][i];
+                double energy = std::sqrt(ax * ax + ay * ay + az * az + PI_PLUS_MASS * PI_PLUS_MASS) +
+                                std::sqrt(bx * bx + by * by + bz * bz + PI_PLUS_MASS * PI_PLUS_MASS);
+                double px = ax + bx, py = ay + by, pz = az + bz;
+                out[i] = float(std::sqrt(std::max(0.0, energy * energy - px * px - py * py - pz * pz)));
+            }
+            break;
+        case kNuEnergyCCQE:
+            // Muon-only CCQE estimate on a bound neutron, beam along z; BOGUS
+            // where the kinematics give no physical solution
+            for (size_t i = 0; i < n; ++i) {
+                const double bound_mass = NEUTRON_MASS - BINDING_ENERGY;
+                double px = in[kMuonPx][i], py = in[kMuonPy][i], pz = in[kMuonPz][i];
+                double energy = in[kMuonEnergy][i];
+                double numerator = 2 * bound_mass * energy - (bound_mass * bound_mass + MUON_MASS * MUON_MASS - PROTON_MASS * PROTON_MASS);
+                double denominator = 2 * (bound_mass - energy + pz);
+                out[i] = (denominator > 0 && px * px + py * py + pz * pz > 0) ? float(numerator / denominator) : BOGUS;
+            }
+            break;
+        case kMuonVertexDistance:
+            distance(in, kMuonStartX, kNuVtxX, n, out);
+            break;
+        case kPiPlusDecayDistance:
+            distance(in, kPiPlusStartX, kKShortEndX, n, out);
+            break;
+        case kPiMinusDecayDistance:
+            distance(in, kPiMinusStartX, kKShortEndX, n, out);
+            break;
+        case kRecoVertexDistance:
+            distance(in, kRecoVtxX, kNuVtxX, n, out);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+#endif // DERIVEDCOLUMNENGINE_H
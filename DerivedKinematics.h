@@ -0,0 +1,53 @@
+#ifndef DERIVEDKINEMATICS_H
+#define DERIVEDKINEMATICS_H
+
+#include <string>
+#include <vector>
+
+enum DerivedColumn
+{
+    kMuonMomentum = 0,
+    kPiPlusMomentum,
+    kPiMinusMomentum,
+    kPiPiOpeningAngle,
+    kPiPiInvariantMass,
+    kNuEnergyCCQE,
+    kMuonVertexDistance,
+    kPiPlusDecayDistance,
+    kPiMinusDecayDistance,
+    kRecoVertexDistance,
+    kNumDerivedColumns
+};
+
+// Branch names in the friend tree
+static const char* const derived_column_names[kNumDerivedColumns] = {
+    "muon_p",
+    "piplus_p",
+    "piminus_p",
+    "pipi_opening_angle",
+    "pipi_mass",
+    "nu_energy_ccqe",
+    "muon_vtx_dist",
+    "piplus_decay_dist",
+    "piminus_decay_dist",
+    "reco_vtx_dist"
+};
+
+inline std::vector<DerivedColumn> all_derived_columns()
+{
+    std::vector<DerivedColumn> columns;
+    for (int c = 0; c < kNumDerivedColumns; ++c) columns.push_back(DerivedColumn(c));
+    return columns;
+}
+
+// Quantities derived from the truth and vertex branches of one event,
+// indexed by DerivedColumn
+struct DerivedKinematics
+{
+    float values[kNumDerivedColumns] = {};
+
+    float operator[](DerivedColumn c) const { return values[c]; }
+    float& operator[](DerivedColumn c) { return values[c]; }
+};
+
+#endif // DERIVEDKINEMATICS_H
@@ -10,11 +10,20 @@
 #include "TLegend.h"
 #include "TStyle.h"
 #include "TROOT.h"
+#include "TColor.h"
 
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <string>
+#include <stdexcept>
+#include <memory_resource>
+
+#include "EventArena.h"
+#include "RasterImage.h"
+#include "HitGrid.h"
+#include "WirePlaneGeometry.h"
+#include "SpaceChargeMap.h"
 
 class DisplayAssembler
 {
@@ -28,6 +37,7 @@ public:
     }
 
     DisplayAssembler(const std::string& input_name) 
+        : geometry_(&WirePlaneGeometry::microboone()), space_charge_(nullptr)
     {
         file_ = TFile::Open(input_name.c_str(), "READ");
         tree_ = dynamic_cast<TTree*>(file_->Get("emptyselectionfilter/StrangenessSelectionFilter"));
@@ -46,15 +56,161 @@ public:
 
     void plot_event(int i_event) const
     {
-        tree_->GetEntry(i_event);
+        load_event(i_event);
 
         display_event_hits();
         display_reconstructed_hits();
     }
 
+    enum HitSource { kTrueHits, kRecoHits };
+
+    // U, V and W panels stacked top to bottom, hits binned straight into
+    // pixels with the same palettes as plot_event, optionally with the truth
+    // segments drawn over them
+    RasterImage rasterise_event(int i_event, HitSource source, int panel_width = 500, int panel_height = 250, bool draw_truth = false) const
+    {
+        load_event(i_event);
+        return rasterise(source, panel_width, panel_height, draw_truth);
+    }
+
+    void write_event_png(int i_event, const std::string& output_dir = "./plots", int panel_width = 500, int panel_height = 250) const
+    {
+        load_event(i_event);
+
+        std::string suffix = std::to_string(run_) + "_" + std::to_string(subrun_) + "_" + std::to_string(event_) + ".png";
+        rasterise(kTrueHits, panel_width, panel_height, true).write_png(output_dir + "/true_interaction_hits_" + suffix);
+        rasterise(kRecoHits, panel_width, panel_height, false).write_png(output_dir + "/reco_interaction_hits_" + suffix);
+    }
+
+    // Many events as thumbnails in one image, row by row in the given order
+    void write_montage_png(const std::vector<int>& entries, HitSource source, const std::string& path,
+                           int columns = 8, int panel_width = 240, int panel_height = 80) const
+    {
+        std::vector<RasterImage> thumbnails;
+        thumbnails.reserve(entries.size());
+        for (int entry : entries) thumbnails.push_back(rasterise_event(entry, source, panel_width, panel_height));
+        RasterImage::tile(thumbnails, columns, 4).write_png(path);
+    }
+
+    static Color_t get_pdg_colour(int pdg)
+    {
+        switch (std::abs(pdg)) {
+            case 13: return kBlue;          // Muon
+            case 11: return kRed;           // Electron
+            case 2212: return kGreen;       // Proton
+            case 211: return kPink + 9;     // Pion
+            case 22: return kOrange;        // Photon
+            default: return kGray;
+        }
+    }
+
+    // Coarse owner classes of true hits; kNoOwner marks an empty pixel or cell
+    enum OwnerClass { kNoOwner, kOwnerMuon, kOwnerPion, kOwnerProton, kOwnerElectron, kOwnerPhoton, kOwnerOther, kNumOwnerClasses };
+
+    static int get_owner_class(int pdg)
+    {
+        switch (std::abs(pdg)) {
+            case 13: return kOwnerMuon;
+            case 211: return kOwnerPion;
+            case 2212: return kOwnerProton;
+            case 11: return kOwnerElectron;
+            case 22: return kOwnerPhoton;
+            default: return kOwnerOther;
+        }
+    }
+
+    static const char* get_owner_class_name(int owner_class)
+    {
+        static const char* const names[kNumOwnerClasses] = { "none", "muon", "pion", "proton", "electron", "photon", "other" };
+        return owner_class >= 0 && owner_class < kNumOwnerClasses ? names[owner_class] : "invalid";
+    }
+
+    static const std::vector<int>& get_pfp_palette()
+    {
+        static const std::vector<int> palette = {
+            kMagenta, kCyan, kYellow, kAzure, kSpring, kTeal, kRose, kGray, kBlack, kViolet,
+            kOrange + 7, kBlue - 9, kGreen + 3, kViolet + 9, kCyan + 3, kYellow + 2, kGray + 2
+        };
+        return palette;
+    }
+
+    // One plane's hit arrays for the entry last read, so per-plane consumers
+    // (raster displays, image export) are written once for U, V and W
+    struct PlaneHits
+    {
+        const std::vector<float>* wire;
+        const std::vector<float>* drift;
+        const std::vector<float>* owner;
+        const std::vector<std::vector<float>>* reco_wire;
+        const std::vector<std::vector<float>>* reco_drift;
+        float true_vertex_wire;
+        float reco_vertex_wire;
+        float true_vertex_drift;
+        float reco_vertex_drift;
+    };
+
+    void load_event(int i_event) const
+    {
+        EventArena::local().begin_entry(i_event);
+        tree_->GetEntry(i_event);
+    }
+
+    PlaneHits get_plane(int plane) const
+    {
+        if (plane == 0) return { hits_u_wire_, hits_u_drift_, hits_u_owner_, reco_hits_u_wire_, reco_hits_u_drift_, true_nu_vtx_u_wire_, reco_nu_vtx_u_wire_, true_nu_vtx_x_, reco_nu_vtx_x_ };
+        if (plane == 1) return { hits_v_wire_, hits_v_drift_, hits_v_owner_, reco_hits_v_wire_, reco_hits_v_drift_, true_nu_vtx_v_wire_, reco_nu_vtx_v_wire_, true_nu_vtx_x_, reco_nu_vtx_x_ };
+        return { hits_w_wire_, hits_w_drift_, hits_w_owner_, reco_hits_w_wire_, reco_hits_w_drift_, true_nu_vtx_w_wire_, reco_nu_vtx_w_wire_, true_nu_vtx_x_, reco_nu_vtx_x_ };
+    }
+
+    // Slice hits of one plane, all PFPs concatenated in PFP order
+    void get_slice_hits(int plane, std::pmr::vector<float>& wires, std::pmr::vector<float>& drifts) const
+    {
+        PlaneHits hits = get_plane(plane);
+        for (size_t k = 0; k < hits.reco_wire->size(); ++k) {
+            wires.insert(wires.end(), hits.reco_wire->at(k).begin(), hits.reco_wire->at(k).end());
+            drifts.insert(drifts.end(), hits.reco_drift->at(k).begin(), hits.reco_drift->at(k).end());
+        }
+        if (wires.size() != drifts.size())
+            throw std::invalid_argument("DisplayAssembler: slice hit wire and drift arrays differ in length");
+    }
+
+    // Spatial index over one plane of the loaded entry; slice hit indices
+    // follow get_slice_hits
+    HitGrid build_hit_grid(int plane, HitSource source, float cell_size = 2.0) const
+    {
+        PlaneHits hits = get_plane(plane);
+        if (source == kTrueHits) return HitGrid(*hits.wire, *hits.drift, cell_size);
+
+        std::pmr::memory_resource* arena = EventArena::local().resource();
+        std::pmr::vector<float> wires(arena), drifts(arena);
+        get_slice_hits(plane, wires, drifts);
+        return HitGrid(wires.data(), drifts.data(), wires.size(), cell_size);
+    }
+
+    // Projects the truth segments; the default is WirePlaneGeometry::microboone()
+    void set_geometry(const WirePlaneGeometry& geometry) { geometry_ = &geometry; }
+    const WirePlaneGeometry& get_geometry() const { return *geometry_; }
+
+    // Moves the truth end points to where their charge is seen, as for the
+    // hits and the true_nu_vtx_sce vertex; null (the default) leaves them
+    void set_space_charge_map(const SpaceChargeMap* space_charge) { space_charge_ = space_charge; }
+
+    // Muon, K0S and decay-pion segments of the loaded entry
+    std::vector<TruthSegment> get_truth_segments() const
+    {
+        std::vector<TruthSegment> segments = ::get_truth_segments(truth_);
+        if (space_charge_) space_charge_->apply(SpaceChargeMap::kForward, segments);
+        return segments;
+    }
+
 private:
     TFile* file_;
     TTree* tree_;
+    const WirePlaneGeometry* geometry_;
+    const SpaceChargeMap* space_charge_;
+
+    // Only the truth end points used by get_truth_segments are bound
+    AnalysisEvent truth_{};
 
     int event_, run_, subrun_;
 
@@ -69,40 +225,184 @@ private:
     std::vector<std::vector<float>> *reco_hits_v_wire_ = nullptr, *reco_hits_v_drift_ = nullptr;
     std::vector<std::vector<float>> *reco_hits_w_wire_ = nullptr, *reco_hits_w_drift_ = nullptr;
 
+    static uint32_t to_rgb(int colour_index)
+    {
+        TColor* colour = gROOT->GetColor(colour_index);
+        if (!colour) return 0x808080;
+        return (uint32_t(colour->GetRed() * 255 + 0.5f) << 16) | (uint32_t(colour->GetGreen() * 255 + 0.5f) << 8) | uint32_t(colour->GetBlue() * 255 + 0.5f);
+    }
+
+    RasterImage rasterise(HitSource source, int panel_width, int panel_height, bool draw_truth) const
+    {
+        const float buffer = 10.0;
+        const int n_planes = 3;
+
+        // Drift range shared by the planes, wire range per plane, as in plot_event
+        float drift_min = 1e10, drift_max = -1e10;
+        float wire_min[n_planes], wire_max[n_planes];
+        for (int p = 0; p < n_planes; ++p) {
+            PlaneHits plane = get_plane(p);
+            wire_min[p] = 1e10;
+            wire_max[p] = -1e10;
+            if (source == kTrueHits) {
+                get_limits(*plane.wire, *plane.drift, wire_min[p], wire_max[p], drift_min, drift_max);
+            }
+            else {
+                for (size_t k = 0; k < plane.reco_wire->size(); ++k)
+                    get_limits(plane.reco_wire->at(k), plane.reco_drift->at(k), wire_min[p], wire_max[p], drift_min, drift_max);
+            }
+        }
+        if (drift_min > drift_max) drift_min = drift_max = 0;
+        drift_min -= buffer;
+        drift_max += buffer;
+        float drift_scale = (panel_width - 1) / (drift_max - drift_min);
+
+        std::vector<TruthSegment> segments;
+        std::vector<uint32_t> segment_colours;
+        if (draw_truth) {
+            segments = get_truth_segments();
+            for (const TruthSegment& segment : segments) segment_colours.push_back(to_rgb(segment.colour));
+        }
+
+        RasterImage image(panel_width, n_planes * panel_height);
+        const uint32_t black = 0x000000;
+        for (int p = 0; p < n_planes; ++p) {
+            PlaneHits plane = get_plane(p);
+            if (wire_min[p] > wire_max[p]) wire_min[p] = wire_max[p] = 0;
+            float low = wire_min[p] - buffer;
+            float wire_scale = (panel_height - 1) / (wire_max[p] + buffer - low);
+            int top = p * panel_height;
+
+            auto to_x = [&](float drift) { return int((drift - drift_min) * drift_scale + 0.5f); };
+            auto to_y = [&](float wire) { return top + (panel_height - 1) - int((wire - low) * wire_scale + 0.5f); };
+
+            if (source == kTrueHits) {
+                int last_pdg = -1;
+                uint32_t colour = 0;
+                for (size_t i = 0; i < plane.wire->size(); ++i) {
+                    int pdg = std::abs(int(plane.owner->at(i)));
+                    if (pdg != last_pdg) {
+                        colour = to_rgb(get_pdg_colour(pdg));
+                        last_pdg = pdg;
+                    }
+                    image.set(to_x(plane.drift->at(i)), to_y(plane.wire->at(i)), colour);
+                }
+            }
+            else {
+                const std::vector<int>& palette = get_pfp_palette();
+                for (size_t k = 0; k < plane.reco_wire->size(); ++k) {
+                    uint32_t colour = to_rgb(palette[k % palette.size()]);
+                    const std::vector<float>& wires = plane.reco_wire->at(k);
+                    const std::vector<float>& drifts = plane.reco_drift->at(k);
+                    for (size_t hit = 0; hit < wires.size(); ++hit) image.set(to_x(drifts[hit]), to_y(wires[hit]), colour);
+                }
+            }
+
+            if (!segments.empty()) {
+                std::vector<float> wires = geometry_->project_segments(p, segments);
+                for (size_t k = 0; k < segments.size(); ++k) {
+                    image.draw_line(to_x(segments[k].start[0]), to_y(wires[2 * k]),
+                                    to_x(segments[k].end[0]), to_y(wires[2 * k + 1]), segment_colours[k]);
+                }
+            }
+
+            float vertex_drift = source == kTrueHits ? plane.true_vertex_drift : plane.reco_vertex_drift;
+            float vertex_wire = source == kTrueHits ? plane.true_vertex_wire : plane.reco_vertex_wire;
+            image.draw_rect(to_x(vertex_drift) - 3, to_y(vertex_wire) - 3, 7, 7, black);
+            image.draw_rect(0, top, panel_width, panel_height, 0xC0C0C0);
+        }
+
+        return image;
+    }
+
+    // Only the display branches are read; the rest of the tree stays disabled
     void set_branch_addresses() 
     {   
-        tree_->SetBranchAddress("evt", &event_);
-        tree_->SetBranchAddress("run", &run_);
-        tree_->SetBranchAddress("sub", &subrun_);
-
-        tree_->SetBranchAddress("true_nu_vtx_sce_x", &true_nu_vtx_x_);
-        tree_->SetBranchAddress("true_nu_vtx_sce_u_wire", &true_nu_vtx_u_wire_);
-        tree_->SetBranchAddress("true_nu_vtx_sce_v_wire", &true_nu_vtx_v_wire_);
-        tree_->SetBranchAddress("true_nu_vtx_sce_w_wire", &true_nu_vtx_w_wire_);
-
-        tree_->SetBranchAddress("reco_nu_vtx_x", &reco_nu_vtx_x_);
-        tree_->SetBranchAddress("reco_nu_vtx_sce_u_wire", &reco_nu_vtx_u_wire_);
-        tree_->SetBranchAddress("reco_nu_vtx_sce_v_wire", &reco_nu_vtx_v_wire_);
-        tree_->SetBranchAddress("reco_nu_vtx_sce_w_wire", &reco_nu_vtx_w_wire_);
-
-        tree_->SetBranchAddress("true_hits_u_wire", &hits_u_wire_);
-        tree_->SetBranchAddress("true_hits_u_drift", &hits_u_drift_);
-        tree_->SetBranchAddress("true_hits_u_owner", &hits_u_owner_);
-
-        tree_->SetBranchAddress("true_hits_v_wire", &hits_v_wire_);
-        tree_->SetBranchAddress("true_hits_v_drift", &hits_v_drift_);
-        tree_->SetBranchAddress("true_hits_v_owner", &hits_v_owner_);
-
-        tree_->SetBranchAddress("true_hits_w_wire", &hits_w_wire_);
-        tree_->SetBranchAddress("true_hits_w_drift", &hits_w_drift_);
-        tree_->SetBranchAddress("true_hits_w_owner", &hits_w_owner_);
-
-        tree_->SetBranchAddress("slice_hits_u_wire", &reco_hits_u_wire_);
-        tree_->SetBranchAddress("slice_hits_u_drift", &reco_hits_u_drift_);
-        tree_->SetBranchAddress("slice_hits_v_wire", &reco_hits_v_wire_);
-        tree_->SetBranchAddress("slice_hits_v_drift", &reco_hits_v_drift_);
-        tree_->SetBranchAddress("slice_hits_w_wire", &reco_hits_w_wire_);
-        tree_->SetBranchAddress("slice_hits_w_drift", &reco_hits_w_drift_);
+        tree_->SetBranchStatus("*", false);
+
+        bind("evt", &event_);
+        bind("run", &run_);
+        bind("sub", &subrun_);
+
+        bind("true_nu_vtx_sce_x", &true_nu_vtx_x_);
+        bind("true_nu_vtx_sce_u_wire", &true_nu_vtx_u_wire_);
+        bind("true_nu_vtx_sce_v_wire", &true_nu_vtx_v_wire_);
+        bind("true_nu_vtx_sce_w_wire", &true_nu_vtx_w_wire_);
+
+        bind("reco_nu_vtx_x", &reco_nu_vtx_x_);
+        bind("reco_nu_vtx_sce_u_wire", &reco_nu_vtx_u_wire_);
+        bind("reco_nu_vtx_sce_v_wire", &reco_nu_vtx_v_wire_);
+        bind("reco_nu_vtx_sce_w_wire", &reco_nu_vtx_w_wire_);
+
+        bind("true_hits_u_wire", &hits_u_wire_);
+        bind("true_hits_u_drift", &hits_u_drift_);
+        bind("true_hits_u_owner", &hits_u_owner_);
+
+        bind("true_hits_v_wire", &hits_v_wire_);
+        bind("true_hits_v_drift", &hits_v_drift_);
+        bind("true_hits_v_owner", &hits_v_owner_);
+
+        bind("true_hits_w_wire", &hits_w_wire_);
+        bind("true_hits_w_drift", &hits_w_drift_);
+        bind("true_hits_w_owner", &hits_w_owner_);
+
+        bind("slice_hits_u_wire", &reco_hits_u_wire_);
+        bind("slice_hits_u_drift", &reco_hits_u_drift_);
+        bind("slice_hits_v_wire", &reco_hits_v_wire_);
+        bind("slice_hits_v_drift", &reco_hits_v_drift_);
+        bind("slice_hits_w_wire", &reco_hits_w_wire_);
+        bind("slice_hits_w_drift", &reco_hits_w_drift_);
+
+        bind("true_nu_vtx_x", &truth_.mc_nu_vtx_x);
+        bind("true_nu_vtx_y", &truth_.mc_nu_vtx_y);
+        bind("true_nu_vtx_z", &truth_.mc_nu_vtx_z);
+        bind("mc_has_muon", &truth_.mc_has_muon);
+        bind("mc_is_kshort_decay_pionic", &truth_.mc_is_kshort_decay_pionic);
+
+        bind("mc_muon_startx", &truth_.mc_muon_startx);
+        bind("mc_muon_starty", &truth_.mc_muon_starty);
+        bind("mc_muon_startz", &truth_.mc_muon_startz);
+        bind("mc_muon_endx", &truth_.mc_muon_endx);
+        bind("mc_muon_endy", &truth_.mc_muon_endy);
+        bind("mc_muon_endz", &truth_.mc_muon_endz);
+
+        bind("mc_kaon_decay_x", &truth_.mc_kshrt_endx);
+        bind("mc_kaon_decay_y", &truth_.mc_kshrt_endy);
+        bind("mc_kaon_decay_z", &truth_.mc_kshrt_endz);
+
+        bind("mc_kshrt_piplus_startx", &truth_.mc_kshrt_piplus_startx);
+        bind("mc_kshrt_piplus_starty", &truth_.mc_kshrt_piplus_starty);
+        bind("mc_kshrt_piplus_startz", &truth_.mc_kshrt_piplus_startz);
+        bind("mc_kshrt_piplus_endx", &truth_.mc_kshrt_piplus_endx);
+        bind("mc_kshrt_piplus_endy", &truth_.mc_kshrt_piplus_endy);
+        bind("mc_kshrt_piplus_endz", &truth_.mc_kshrt_piplus_endz);
+
+        bind("mc_kshrt_piminus_startx", &truth_.mc_kshrt_piminus_startx);
+        bind("mc_kshrt_piminus_starty", &truth_.mc_kshrt_piminus_starty);
+        bind("mc_kshrt_piminus_startz", &truth_.mc_kshrt_piminus_startz);
+        bind("mc_kshrt_piminus_endx", &truth_.mc_kshrt_piminus_endx);
+        bind("mc_kshrt_piminus_endy", &truth_.mc_kshrt_piminus_endy);
+        bind("mc_kshrt_piminus_endz", &truth_.mc_kshrt_piminus_endz);
+    }
+
+    // One line graph per truth segment, drawn with the "L" option
+    void add_truth_graphs(TMultiGraph* graphs, int plane, const std::vector<TruthSegment>& segments) const
+    {
+        std::vector<float> wires = geometry_->project_segments(plane, segments);
+        for (size_t k = 0; k < segments.size(); ++k) {
+            TGraph* line = new TGraph();
+            line->SetPoint(0, segments[k].start[0], wires[2 * k]);
+            line->SetPoint(1, segments[k].end[0], wires[2 * k + 1]);
+            line->SetLineColor(segments[k].colour);
+            line->SetLineWidth(2);
+            graphs->Add(line, "L");
+        }
+    }
+
+    template <typename T> void bind(const char* name, T* address)
+    {
+        tree_->SetBranchStatus(name, true);
+        tree_->SetBranchAddress(name, address);
     }
 
     void get_limits(const std::vector<float>& wire_coord_vec, const std::vector<float>& drift_coord_vec,
@@ -132,6 +432,8 @@ private:
         get_limits(*hits_v_wire_, *hits_v_drift_, wire_min_v_truth, wire_max_v_truth, global_true_drift_min, global_true_drift_max);
         get_limits(*hits_w_wire_, *hits_w_drift_, wire_min_w_truth, wire_max_w_truth, global_true_drift_min, global_true_drift_max);
 
+        std::vector<TruthSegment> segments = get_truth_segments();
+
         // Create TMultiGraphs and TGraphs for each view (U, V, W)
         TCanvas* c4 = new TCanvas("c4", "", 1500, 1500);
         c4->Divide(1, 3, 0, 0);
@@ -164,7 +466,7 @@ private:
         true_vertex_w->SetMarkerSize(1.2);
 
         // Create TGraphs for each PDG
-        std::map<int, TGraph*> pdg_graphs;
+        std::pmr::map<int, TGraph*> pdg_graphs(EventArena::local().resource());
         for (size_t i = 0; i < hits_u_wire_->size(); ++i) {
             int pdg = std::abs(hits_u_owner_->at(i));
 
@@ -172,13 +474,7 @@ private:
                 pdg_graphs[pdg] = new TGraph();
                 pdg_graphs[pdg]->SetMarkerStyle(20);
                 pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
+                pdg_graphs[pdg]->SetMarkerColor(get_pdg_colour(pdg));
             }
 
             pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), hits_u_drift_->at(i), hits_u_wire_->at(i));
@@ -188,6 +484,7 @@ private:
             mg_u->Add(entry.second);
         }
         mg_u->Add(true_vertex_u);
+        add_truth_graphs(mg_u, 0, segments);
 
         c4->cd(1);
         mg_u->Draw("AP");
@@ -205,13 +502,7 @@ private:
                 pdg_graphs[pdg] = new TGraph();
                 pdg_graphs[pdg]->SetMarkerStyle(20);
                 pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
+                pdg_graphs[pdg]->SetMarkerColor(get_pdg_colour(pdg));
             }
 
             pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), hits_v_drift_->at(i), hits_v_wire_->at(i));
@@ -221,6 +512,7 @@ private:
             mg_v->Add(entry.second);
         }
         mg_v->Add(true_vertex_v);
+        add_truth_graphs(mg_v, 1, segments);
 
         c4->cd(2);
         mg_v->Draw("AP");
@@ -238,13 +530,7 @@ private:
                 pdg_graphs[pdg] = new TGraph();
                 pdg_graphs[pdg]->SetMarkerStyle(20);
                 pdg_graphs[pdg]->SetMarkerSize(0.5);
-                pdg_graphs[pdg]->SetMarkerColor(kGray); // Default color
-
-                if (pdg == 13) pdg_graphs[pdg]->SetMarkerColor(kBlue); // Muon
-                else if (pdg == 11) pdg_graphs[pdg]->SetMarkerColor(kRed); // Electron
-                else if (pdg == 2212) pdg_graphs[pdg]->SetMarkerColor(kGreen); // Proton
-                else if (pdg == 211) pdg_graphs[pdg]->SetMarkerColor(kPink + 9); // Pion
-                else if (pdg == 22) pdg_graphs[pdg]->SetMarkerColor(kOrange); // Photon
+                pdg_graphs[pdg]->SetMarkerColor(get_pdg_colour(pdg));
             }
 
             pdg_graphs[pdg]->SetPoint(pdg_graphs[pdg]->GetN(), hits_w_drift_->at(i), hits_w_wire_->at(i));
@@ -254,6 +540,7 @@ private:
             mg_w->Add(entry.second);
         }
         mg_w->Add(true_vertex_w);
+        add_truth_graphs(mg_w, 2, segments);
 
         c4->cd(3);
         mg_w->Draw("AP");
@@ -263,6 +550,12 @@ private:
 
         std::string filename = "true_interaction_hits_" + std::to_string(run_) + "_" + std::to_string(subrun_) + "_" + std::to_string(event_);
         c4->SaveAs(("./plots/" + filename + ".pdf").c_str());
+
+        // The multigraphs own their graphs; batch rendering would otherwise leak every event
+        delete c4;
+        delete mg_u;
+        delete mg_v;
+        delete mg_w;
     }
 
     void display_reconstructed_hits() const {
@@ -314,14 +607,11 @@ private:
         reco_vertex_w->SetMarkerColor(kBlack);
         reco_vertex_w->SetMarkerSize(1.2);
 
-        std::vector<int> color_map = {
-            kMagenta, kCyan, kYellow, kAzure, kSpring, kTeal, kRose, kGray, kBlack, kViolet,
-            kOrange + 7, kBlue - 9, kGreen + 3, kViolet + 9, kCyan + 3, kYellow + 2, kGray + 2
-        };
+        const std::vector<int>& color_map = get_pfp_palette();
 
         int colour_map_index = 0;
         for (size_t i = 0; i < reco_hits_u_drift_->size(); ++i) {
-            int particle_color = color_map[colour_map_index];
+            int particle_color = color_map[colour_map_index % color_map.size()];
             colour_map_index++;
 
             TGraph* pfp_graph_u = new TGraph();
@@ -342,7 +632,7 @@ private:
 
         colour_map_index = 0;
         for (size_t i = 0; i < reco_hits_v_drift_->size(); ++i) {
-            int particle_color = color_map[colour_map_index];
+            int particle_color = color_map[colour_map_index % color_map.size()];
             colour_map_index++;
 
             TGraph* pfp_graph_v = new TGraph();
@@ -363,7 +653,7 @@ private:
 
         colour_map_index = 0;
         for (size_t i = 0; i < reco_hits_w_drift_->size(); ++i) {
-            int particle_color = color_map[colour_map_index];
+            int particle_color = color_map[colour_map_index % color_map.size()];
             colour_map_index++;
 
             TGraph* pfp_graph_w = new TGraph();
@@ -402,6 +692,11 @@ private:
 
         std::string filename = "reco_interaction_hits_" + std::to_string(run_) + "_" + std::to_string(subrun_) + "_" + std::to_string(event_);
         c5->SaveAs(("./plots/" + filename + ".pdf").c_str());
+
+        delete c5;
+        delete reco_mg_u;
+        delete reco_mg_v;
+        delete reco_mg_w;
     }
 };
 
@@ -0,0 +1,138 @@
+#ifndef DISPLAYQUEUE_H
+#define DISPLAYQUEUE_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TROOT.h"
+
+#include "DisplayAssembler.h"
+
+// Event displays requested during an analysis loop. The loop only records
+// entry numbers; render() draws them afterwards in forked batch-mode
+// processes, each with its own file handle and a contiguous slice of the
+// sorted entries. ROOT graphics are not thread-safe, so the workers are
+// processes rather than threads.
+class DisplayQueue
+{
+public:
+    // kPdf draws through TCanvas; kPng rasterises the hits directly
+    enum Format { kPdf, kPng };
+
+    // A negative limit accepts every request
+    DisplayQueue(const std::string& input_name, int max_displays = -1)
+        : input_name_(input_name), max_displays_(max_displays) {}
+
+    // False once the queue is full, so callers can stop testing for displays
+    bool add(int entry)
+    {
+        if (is_full()) return false;
+        entries_.push_back(entry);
+        return true;
+    }
+
+    bool is_full() const { return max_displays_ >= 0 && int(entries_.size()) >= max_displays_; }
+    size_t size() const { return entries_.size(); }
+    const std::vector<int>& get_entries() const { return entries_; }
+
+    void render(int n_workers = 4, Format format = kPdf) const
+    {
+        if (entries_.empty()) return;
+
+        std::vector<int> entries = entries_;
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+        n_workers = std::max(1, std::min(n_workers, int(entries.size())));
+        if (n_workers == 1) {
+            // In-process, so hand the session back in the graphics mode it had
+            bool was_batch = gROOT->IsBatch();
+            gROOT->SetBatch(kTRUE);
+            try {
+                render_range(DisplayAssembler::instance(input_name_), entries, 0, entries.size(), format);
+            }
+            catch (...) {
+                gROOT->SetBatch(was_batch);
+                throw;
+            }
+            gROOT->SetBatch(was_batch);
+            return;
+        }
+
+        std::vector<pid_t> workers;
+        size_t chunk = (entries.size() + n_workers - 1) / n_workers;
+        for (int w = 0; w < n_workers; ++w) {
+            size_t first = w * chunk;
+            size_t last = std::min(entries.size(), first + chunk);
+            if (first >= last) break;
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                wait_for(workers);
+                throw std::runtime_error("DisplayQueue: cannot fork render worker");
+            }
+            if (pid == 0) {
+                // Child: own file handle, no static destructors on the way out
+                int status = 0;
+                try {
+                    gROOT->SetBatch(kTRUE);
+                    DisplayAssembler assembler(input_name_);
+                    render_range(assembler, entries, first, last, format);
+                }
+                catch (const std::exception& ex) {
+                    std::cerr << "DisplayQueue: worker " << w << ": " << ex.what() << std::endl;
+                    status = 1;
+                }
+                std::cout.flush();
+                _exit(status);
+            }
+            workers.push_back(pid);
+        }
+
+        int failed = wait_for(workers);
+        if (failed > 0)
+            throw std::runtime_error("DisplayQueue: " + std::to_string(failed) + " render workers failed");
+
+        std::cout << "DisplayQueue: rendered " << entries.size() << " events with " << workers.size() << " workers" << std::endl;
+    }
+
+    // All queued events as thumbnails in one image, in the order they were queued
+    void render_montage(const std::string& path, DisplayAssembler::HitSource source = DisplayAssembler::kTrueHits, int columns = 8) const
+    {
+        if (entries_.empty()) return;
+        DisplayAssembler::instance(input_name_).write_montage_png(entries_, source, path, columns);
+    }
+
+private:
+    std::string input_name_;
+    int max_displays_;
+    std::vector<int> entries_;
+
+    static void render_range(const DisplayAssembler& assembler, const std::vector<int>& entries, size_t first, size_t last, Format format)
+    {
+        for (size_t k = first; k < last; ++k) {
+            if (format == kPng) assembler.write_event_png(entries[k]);
+            else assembler.plot_event(entries[k]);
+        }
+    }
+
+    // Number of workers that did not exit cleanly
+    static int wait_for(const std::vector<pid_t>& workers)
+    {
+        int failed = 0;
+        for (pid_t pid : workers) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+        }
+        return failed;
+    }
+};
+
+#endif // DISPLAYQUEUE_H
@@ -0,0 +1,281 @@
+#ifndef EFFICIENCYENGINE_H
+#define EFFICIENCYENGINE_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "TH1D.h"
+#include "TEfficiency.h"
+
+#include "AnalysisEvent.h"
+
+// Efficiency curves declared as (variable, binning, numerator, denominator).
+// Each selection is evaluated once per event and shared by every curve that
+// uses it; values are buffered and binned in batches into flat passed/total
+// arrays. Engines filled on separate threads combine with merge().
+class EfficiencyEngine
+{
+public:
+    typedef std::function<bool(const AnalysisEvent&)> Selection;
+    typedef std::function<double(const AnalysisEvent&)> Variable;
+
+    static constexpr int batch_size = 256;
+
+    EfficiencyEngine() : n_buffered_(0) {}
+
+    int define_selection(const std::string& name, Selection selection)
+    {
+        for (size_t i = 0; i < selection_names_.size(); ++i) {
+            if (selection_names_[i] == name)
+                throw std::invalid_argument("EfficiencyEngine: selection '" + name + "' is already defined");
+        }
+
+        selection_names_.push_back(name);
+        selections_.push_back(selection);
+        selection_results_.push_back(false);
+        return int(selections_.size()) - 1;
+    }
+
+    int get_selection(const std::string& name) const
+    {
+        for (size_t i = 0; i < selection_names_.size(); ++i) {
+            if (selection_names_[i] == name) return int(i);
+        }
+        throw std::invalid_argument("EfficiencyEngine: unknown selection '" + name + "'");
+    }
+
+    // Result of a selection for the most recently filled event
+    bool get_selection_result(int selection) const
+    {
+        return selection_results_.at(selection);
+    }
+
+    void add_curve(const std::string& name, const std::string& title, int n_bins, double x_min, double x_max,
+                   Variable variable, int numerator, int denominator)
+    {
+        std::vector<double> edges(n_bins + 1);
+        for (int i = 0; i <= n_bins; ++i) edges[i] = x_min + i * (x_max - x_min) / n_bins;
+        add_curve(name, title, edges, variable, numerator, denominator);
+        curves_.back().uniform = true;
+    }
+
+    void add_curve(const std::string& name, const std::string& title, const std::vector<double>& edges,
+                   Variable variable, int numerator, int denominator)
+    {
+        if (edges.size() < 2)
+            throw std::invalid_argument("EfficiencyEngine: curve '" + name + "' needs at least one bin");
+        if (numerator < 0 || numerator >= int(selections_.size()) || denominator < 0 || denominator >= int(selections_.size()))
+            throw std::invalid_argument("EfficiencyEngine: curve '" + name + "' uses an undefined selection");
+        if (find_curve(name) >= 0)
+            throw std::invalid_argument("EfficiencyEngine: curve '" + name + "' is already defined");
+
+        Curve curve;
+        curve.name = name;
+        curve.title = title;
+        curve.edges = edges;
+        curve.uniform = false;
+        curve.variable = variable;
+        curve.numerator = numerator;
+        curve.denominator = denominator;
+        curve.passed.assign(edges.size() + 1, 0.0);
+        curve.total.assign(edges.size() + 1, 0.0);
+        curve.x_buffer.resize(batch_size);
+        curve.pass_buffer.resize(batch_size);
+        curve.in_buffer.resize(batch_size);
+        curve.bin_buffer.resize(batch_size);
+        curves_.push_back(curve);
+    }
+
+    void fill(const AnalysisEvent& e)
+    {
+        for (size_t s = 0; s < selections_.size(); ++s) {
+            selection_results_[s] = selections_[s](e);
+        }
+
+        for (Curve& curve : curves_) {
+            bool in_denominator = selection_results_[curve.denominator];
+            curve.in_buffer[n_buffered_] = in_denominator;
+            curve.pass_buffer[n_buffered_] = in_denominator && selection_results_[curve.numerator];
+            curve.x_buffer[n_buffered_] = in_denominator ? curve.variable(e) : 0.0;
+        }
+
+        if (++n_buffered_ == batch_size) flush();
+    }
+
+    // Bin the buffered values; called automatically, and before reading results
+    void flush()
+    {
+        for (Curve& curve : curves_) {
+            int n_bins = int(curve.edges.size()) - 1;
+
+            // NaN goes to the underflow bin on both paths, as in EfficiencyMap::find_bin;
+            // upper_bound alone would put it in the overflow
+            if (curve.uniform) {
+                double x_min = curve.edges.front();
+                double inv_width = n_bins / (curve.edges.back() - x_min);
+                for (int i = 0; i < n_buffered_; ++i) {
+                    double u = (curve.x_buffer[i] - x_min) * inv_width;
+                    int bin = (std::isnan(u) || u < 0) ? 0 : ((u >= n_bins) ? n_bins + 1 : std::min(n_bins, 1 + int(u)));
+                    curve.bin_buffer[i] = bin;
+                }
+            }
+            else {
+                for (int i = 0; i < n_buffered_; ++i) {
+                    double x = curve.x_buffer[i];
+                    curve.bin_buffer[i] = std::isnan(x) ? 0 : int(std::upper_bound(curve.edges.begin(), curve.edges.end(), x) - curve.edges.begin());
+                }
+            }
+
+            for (int i = 0; i < n_buffered_; ++i) {
+                int bin = curve.bin_buffer[i];
+                curve.total[bin] += curve.in_buffer[i];
+                curve.passed[bin] += curve.pass_buffer[i];
+            }
+        }
+
+        n_buffered_ = 0;
+    }
+
+    void merge(EfficiencyEngine& other)
+    {
+        flush();
+        other.flush();
+
+        if (other.curves_.size() != curves_.size())
+            throw std::invalid_argument("EfficiencyEngine: cannot merge engines with different curves");
+
+        for (size_t c = 0; c < curves_.size(); ++c) {
+            if (other.curves_[c].name != curves_[c].name || other.curves_[c].edges != curves_[c].edges)
+                throw std::invalid_argument("EfficiencyEngine: cannot merge engines with different curves");
+
+            for (size_t b = 0; b < curves_[c].total.size(); ++b) {
+                curves_[c].total[b] += other.curves_[c].total[b];
+                curves_[c].passed[b] += other.curves_[c].passed[b];
+            }
+        }
+    }
+
+    // Empty copy with the same declarations, e.g. one per worker thread
+    EfficiencyEngine clone_empty() const
+    {
+        EfficiencyEngine copy(*this);
+        copy.n_buffered_ = 0;
+        for (Curve& curve : copy.curves_) {
+            std::fill(curve.passed.begin(), curve.passed.end(), 0.0);
+            std::fill(curve.total.begin(), curve.total.end(), 0.0);
+        }
+        return copy;
+    }
+
+    double get_num_passed(const std::string& name)
+    {
+        flush();
+        const Curve& curve = get_curve(name);
+        double sum = 0.0;
+        for (double passed : curve.passed) sum += passed;
+        return sum;
+    }
+
+    double get_num_total(const std::string& name)
+    {
+        flush();
+        const Curve& curve = get_curve(name);
+        double sum = 0.0;
+        for (double total : curve.total) sum += total;
+        return sum;
+    }
+
+    // Caller owns the returned object
+    TEfficiency* make_efficiency(const std::string& name)
+    {
+        flush();
+        const Curve& curve = get_curve(name);
+        int n_bins = int(curve.edges.size()) - 1;
+
+        TH1D h_passed((name + "_passed").c_str(), curve.title.c_str(), n_bins, curve.edges.data());
+        TH1D h_total((name + "_total").c_str(), curve.title.c_str(), n_bins, curve.edges.data());
+        h_passed.SetDirectory(nullptr);
+        h_total.SetDirectory(nullptr);
+
+        double entries = 0.0;
+        for (int bin = 0; bin <= n_bins + 1; ++bin) {
+            h_passed.SetBinContent(bin, curve.passed[bin]);
+            h_total.SetBinContent(bin, curve.total[bin]);
+            entries += curve.total[bin];
+        }
+        h_passed.SetEntries(get_num_passed(name));
+        h_total.SetEntries(entries);
+
+        TEfficiency* effic = new TEfficiency(h_passed, h_total);
+        effic->SetName(name.c_str());
+        effic->SetTitle(curve.title.c_str());
+        return effic;
+    }
+
+    // Hand every curve to a plotting callback, in declaration order
+    void plot_all(std::function<void(TEfficiency*, const std::string&)> plot)
+    {
+        for (const Curve& curve : curves_) {
+            TEfficiency* effic = make_efficiency(curve.name);
+            plot(effic, curve.name);
+            delete effic;
+        }
+    }
+
+    std::vector<std::string> get_curve_names() const
+    {
+        std::vector<std::string> names;
+        for (const Curve& curve : curves_) names.push_back(curve.name);
+        return names;
+    }
+
+private:
+    struct Curve
+    {
+        std::string name;
+        std::string title;
+        std::vector<double> edges;
+        bool uniform;
+        Variable variable;
+        int numerator;
+        int denominator;
+
+        // Bin 0 is underflow and bin n_bins + 1 is overflow, as in ROOT
+        std::vector<double> passed;
+        std::vector<double> total;
+
+        std::vector<double> x_buffer;
+        std::vector<unsigned char> pass_buffer;
+        std::vector<unsigned char> in_buffer;
+        std::vector<int> bin_buffer;
+    };
+
+    std::vector<std::string> selection_names_;
+    std::vector<Selection> selections_;
+    std::vector<bool> selection_results_;
+
+    std::vector<Curve> curves_;
+    int n_buffered_;
+
+    int find_curve(const std::string& name) const
+    {
+        for (size_t i = 0; i < curves_.size(); ++i) {
+            if (curves_[i].name == name) return int(i);
+        }
+        return -1;
+    }
+
+    const Curve& get_curve(const std::string& name) const
+    {
+        int index = find_curve(name);
+        if (index < 0)
+            throw std::invalid_argument("EfficiencyEngine: unknown curve '" + name + "'");
+        return curves_[index];
+    }
+};
+
+#endif // EFFICIENCYENGINE_H
@@ -0,0 +1,250 @@
+#ifndef EFFICIENCYMAP_H
+#define EFFICIENCYMAP_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TEfficiency.h"
+
+#include "AnalysisEvent.h"
+
+struct EfficiencyAxis
+{
+    std::string name;
+    std::string title;
+    int n_bins;
+    double x_min, x_max;
+    std::function<double(const AnalysisEvent&)> variable;
+};
+
+// Keep events whose value on the named axis falls in [low, high); applied per
+// bin using the bin centre
+struct EfficiencyCut
+{
+    std::string axis;
+    double low, high;
+};
+
+// Passed/total counts over N truth variables at once, stored sparsely by a
+// packed bin key so that only occupied cells cost memory. Any 1D or 2D
+// efficiency, with cuts on the remaining axes, is projected from the map
+// without another pass over the events.
+class EfficiencyMap
+{
+public:
+    EfficiencyMap(const std::vector<EfficiencyAxis>& axes)
+        : axes_(axes)
+    {
+        int shift = 0;
+        for (const EfficiencyAxis& axis : axes_) {
+            if (axis.n_bins <= 0 || !(axis.x_max > axis.x_min))
+                throw std::invalid_argument("EfficiencyMap: axis '" + axis.name + "' has invalid binning");
+
+            int bits = 1;
+            while ((uint64_t(1) << bits) < uint64_t(axis.n_bins + 2)) ++bits;
+            shifts_.push_back(shift);
+            masks_.push_back((uint64_t(1) << bits) - 1);
+            shift += bits;
+        }
+
+        if (shift > 64)
+            throw std::invalid_argument("EfficiencyMap: too many bins to pack into a 64-bit key");
+    }
+
+    void fill(const AnalysisEvent& e, bool passed, double w = 1.0)
+    {
+        uint64_t key = 0;
+        for (size_t a = 0; a < axes_.size(); ++a) {
+            key |= uint64_t(find_bin(a, axes_[a].variable(e))) << shifts_[a];
+        }
+        add(key, passed, w);
+    }
+
+    void fill(const std::vector<double>& values, bool passed, double w = 1.0)
+    {
+        if (values.size() != axes_.size())
+            throw std::invalid_argument("EfficiencyMap: expected one value per axis");
+
+        uint64_t key = 0;
+        for (size_t a = 0; a < axes_.size(); ++a) {
+            key |= uint64_t(find_bin(a, values[a])) << shifts_[a];
+        }
+        add(key, passed, w);
+    }
+
+    void merge(const EfficiencyMap& other)
+    {
+        if (other.axes_.size() != axes_.size())
+            throw std::invalid_argument("EfficiencyMap: cannot merge maps with different axes");
+        for (size_t a = 0; a < axes_.size(); ++a) {
+            if (other.axes_[a].name != axes_[a].name || other.axes_[a].n_bins != axes_[a].n_bins ||
+                other.axes_[a].x_min != axes_[a].x_min || other.axes_[a].x_max != axes_[a].x_max)
+                throw std::invalid_argument("EfficiencyMap: cannot merge maps with different axes");
+        }
+
+        for (const auto& cell : other.cells_) {
+            Counts& counts = cells_[cell.first];
+            counts.passed += cell.second.passed;
+            counts.total += cell.second.total;
+        }
+    }
+
+    // Caller owns the returned object
+    TEfficiency* project(const std::string& x_axis, const std::vector<EfficiencyCut>& cuts = {}) const
+    {
+        size_t ax = get_axis(x_axis);
+        const EfficiencyAxis& axis = axes_[ax];
+        std::string name = "effmap_" + axis.name + get_cut_suffix(cuts);
+
+        TH1D h_passed((name + "_passed").c_str(), (";" + axis.title).c_str(), axis.n_bins, axis.x_min, axis.x_max);
+        TH1D h_total((name + "_total").c_str(), (";" + axis.title).c_str(), axis.n_bins, axis.x_min, axis.x_max);
+        h_passed.SetDirectory(nullptr);
+        h_total.SetDirectory(nullptr);
+
+        std::vector<std::vector<bool>> accepted = accepted_bins(cuts);
+        for (const auto& cell : cells_) {
+            if (!passes_cuts(cell.first, accepted)) continue;
+
+            int bin = decode(cell.first, ax);
+            h_passed.SetBinContent(bin, h_passed.GetBinContent(bin) + cell.second.passed);
+            h_total.SetBinContent(bin, h_total.GetBinContent(bin) + cell.second.total);
+        }
+
+        TEfficiency* efficiency = new TEfficiency(h_passed, h_total);
+        efficiency->SetName(name.c_str());
+        return efficiency;
+    }
+
+    // Caller owns the returned object
+    TEfficiency* project(const std::string& x_axis, const std::string& y_axis, const std::vector<EfficiencyCut>& cuts = {}) const
+    {
+        size_t ax = get_axis(x_axis);
+        size_t ay = get_axis(y_axis);
+        const EfficiencyAxis& axis_x = axes_[ax];
+        const EfficiencyAxis& axis_y = axes_[ay];
+        std::string name = "effmap_" + axis_x.name + "_" + axis_y.name + get_cut_suffix(cuts);
+        std::string title = ";" + axis_x.title + ";" + axis_y.title;
+
+        TH2D h_passed((name + "_passed").c_str(), title.c_str(), axis_x.n_bins, axis_x.x_min, axis_x.x_max, axis_y.n_bins, axis_y.x_min, axis_y.x_max);
+        TH2D h_total((name + "_total").c_str(), title.c_str(), axis_x.n_bins, axis_x.x_min, axis_x.x_max, axis_y.n_bins, axis_y.x_min, axis_y.x_max);
+        h_passed.SetDirectory(nullptr);
+        h_total.SetDirectory(nullptr);
+
+        std::vector<std::vector<bool>> accepted = accepted_bins(cuts);
+        for (const auto& cell : cells_) {
+            if (!passes_cuts(cell.first, accepted)) continue;
+
+            int bin_x = decode(cell.first, ax);
+            int bin_y = decode(cell.first, ay);
+            h_passed.SetBinContent(bin_x, bin_y, h_passed.GetBinContent(bin_x, bin_y) + cell.second.passed);
+            h_total.SetBinContent(bin_x, bin_y, h_total.GetBinContent(bin_x, bin_y) + cell.second.total);
+        }
+
+        TEfficiency* efficiency = new TEfficiency(h_passed, h_total);
+        efficiency->SetName(name.c_str());
+        return efficiency;
+    }
+
+    size_t get_num_cells() const { return cells_.size(); }
+    const std::vector<EfficiencyAxis>& get_axes() const { return axes_; }
+
+private:
+    // Projections of the same axes under different cuts need distinct names,
+    // or ROOT replaces one with the other in a directory or output file
+    static std::string get_cut_suffix(const std::vector<EfficiencyCut>& cuts)
+    {
+        std::string suffix;
+        for (const EfficiencyCut& cut : cuts) {
+            char range[64];
+            std::snprintf(range, sizeof(range), "_%g_%g", cut.low, cut.high);
+            suffix += "__" + cut.axis + range;
+        }
+        // Keep the name a valid identifier
+        for (char& c : suffix) {
+            if (c == '.') c = 'p';
+            else if (c == '-') c = 'm';
+            else if (c == '+') c = 'p';
+        }
+        return suffix;
+    }
+
+    struct Counts
+    {
+        double passed = 0.0;
+        double total = 0.0;
+    };
+
+    std::vector<EfficiencyAxis> axes_;
+    std::vector<int> shifts_;
+    std::vector<uint64_t> masks_;
+    std::unordered_map<uint64_t, Counts> cells_;
+
+    void add(uint64_t key, bool passed, double w)
+    {
+        Counts& counts = cells_[key];
+        counts.total += w;
+        if (passed) counts.passed += w;
+    }
+
+    // Bin 0 is underflow and bin n_bins + 1 is overflow, as in ROOT
+    int find_bin(size_t a, double x) const
+    {
+        const EfficiencyAxis& axis = axes_[a];
+        if (!(x >= axis.x_min)) return 0;
+        if (x >= axis.x_max) return axis.n_bins + 1;
+        int bin = 1 + int((x - axis.x_min) * axis.n_bins / (axis.x_max - axis.x_min));
+        return (bin > axis.n_bins) ? axis.n_bins : bin;
+    }
+
+    int decode(uint64_t key, size_t a) const
+    {
+        return int((key >> shifts_[a]) & masks_[a]);
+    }
+
+    size_t get_axis(const std::string& name) const
+    {
+        for (size_t a = 0; a < axes_.size(); ++a) {
+            if (axes_[a].name == name) return a;
+        }
+        throw std::invalid_argument("EfficiencyMap: unknown axis '" + name + "'");
+    }
+
+    std::vector<std::vector<bool>> accepted_bins(const std::vector<EfficiencyCut>& cuts) const
+    {
+        std::vector<std::vector<bool>> accepted(axes_.size());
+        for (size_t a = 0; a < axes_.size(); ++a) accepted[a].assign(axes_[a].n_bins + 2, true);
+
+        for (const EfficiencyCut& cut : cuts) {
+            size_t a = get_axis(cut.axis);
+            const EfficiencyAxis& axis = axes_[a];
+            double width = (axis.x_max - axis.x_min) / axis.n_bins;
+
+            // Under- and overflow have no centre, so any cut removes them
+            accepted[a][0] = false;
+            accepted[a][axis.n_bins + 1] = false;
+            for (int bin = 1; bin <= axis.n_bins; ++bin) {
+                double centre = axis.x_min + (bin - 0.5) * width;
+                if (!(centre >= cut.low && centre < cut.high)) accepted[a][bin] = false;
+            }
+        }
+
+        return accepted;
+    }
+
+    bool passes_cuts(uint64_t key, const std::vector<std::vector<bool>>& accepted) const
+    {
+        for (size_t a = 0; a < axes_.size(); ++a) {
+            if (!accepted[a][decode(key, a)]) return false;
+        }
+        return true;
+    }
+};
+
+#endif // EFFICIENCYMAP_H
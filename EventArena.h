@@ -0,0 +1,94 @@
+#ifndef EVENTARENA_H
+#define EVENTARENA_H
+
+#include <vector>
+#include <memory_resource>
+#include <optional>
+#include <algorithm>
+
+// Per-thread bump allocator for containers that only live for one entry.
+// Everything allocated from it is dropped at once when the thread moves on
+// to a new entry, so per-event maps and vectors cost no heap calls and no
+// allocator lock. If an entry needs more than the buffer holds, the excess
+// comes from the heap and the buffer grows to the high-water mark at the
+// next reset, so steady state stays inside one block.
+//
+// Containers built on resource() must not be kept past the entry they
+// were made for.
+class EventArena
+{
+public:
+    static EventArena& local()
+    {
+        thread_local EventArena arena;
+        return arena;
+    }
+
+    EventArena(size_t initial_bytes = size_t(1) << 20)
+        : buffer_(initial_bytes), entry_(-1), overflow_(0), upstream_(overflow_)
+    {
+        resource_.emplace(buffer_.data(), buffer_.size(), &upstream_);
+    }
+
+    EventArena(const EventArena&) = delete;
+    EventArena& operator=(const EventArena&) = delete;
+
+    // Called by the assemblers on every read; only a change of entry resets,
+    // so several assemblers reading the same entry share one arena lifetime
+    void begin_entry(long entry)
+    {
+        if (entry == entry_) return;
+        entry_ = entry;
+        reset();
+    }
+
+    void reset()
+    {
+        if (overflow_ == 0) {
+            resource_->release();
+            return;
+        }
+
+        // Drop the old arena and its heap chunks before replacing the buffer
+        resource_.reset();
+        buffer_.assign(buffer_.size() + overflow_, 0);
+        overflow_ = 0;
+        resource_.emplace(buffer_.data(), buffer_.size(), &upstream_);
+    }
+
+    std::pmr::memory_resource* resource() { return &*resource_; }
+
+    size_t get_capacity() const { return buffer_.size(); }
+
+private:
+    // Heap fallback that records how far the buffer fell short
+    class OverflowResource : public std::pmr::memory_resource
+    {
+    public:
+        OverflowResource(size_t& overflow) : overflow_(overflow) {}
+
+    private:
+        size_t& overflow_;
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            overflow_ += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    std::vector<unsigned char> buffer_;
+    long entry_;
+    size_t overflow_;
+    OverflowResource upstream_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+#endif // EVENTARENA_H
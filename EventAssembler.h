@@ -5,6 +5,10 @@
 #include <memory>
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 
 #include "TFile.h"
 #include "TTree.h"
@@ -14,6 +18,9 @@
 #include "TreeUtilities.h"
 #include "Constants.h"
 #include "AnalysisEvent.h"
+#include "DerivedColumnEngine.h"
+#include "StringDictionary.h"
+#include "EventArena.h"
 
 class EventAssembler
 {
@@ -24,13 +31,25 @@ public:
     EventAssembler& operator=( const EventAssembler& ) = delete;
     EventAssembler& operator=( EventAssembler&& ) = delete;
 
-    inline static const EventAssembler& instance(const std::string& input_name)
+    inline static const EventAssembler& instance(const std::string& input_name, const std::string& match_index_cache = "",
+                                                 const std::string& derived_friend = "")
     {
-        static std::unique_ptr<EventAssembler> the_instance( new EventAssembler(input_name) );
+        static std::unique_ptr<EventAssembler> the_instance( new EventAssembler(input_name, match_index_cache, derived_friend) );
+        static const std::string the_input = input_name, the_cache = match_index_cache, the_friend = derived_friend;
+
+        // Later calls cannot reopen the singleton on other files
+        if (input_name != the_input || match_index_cache != the_cache || derived_friend != the_friend)
+            throw std::invalid_argument("EventAssembler: instance already open on '" + the_input + "' with a different input, cache or friend");
         return *the_instance;
     }
 
-    EventAssembler(const std::string& input_name)
+    // With a match-index cache the index is read back instead of rebuilt, and
+    // under a branch projection the backtracking and per-PFP purity branches
+    // it was built from are read only if the projection lists them.
+    // Columns found in the derived friend tree are read instead of recomputed.
+    EventAssembler(const std::string& input_name, const std::string& match_index_cache = "",
+                   const std::string& derived_friend = "")
+        : cache_file_(nullptr), cache_tree_(nullptr), build_match_index_(true), computed_columns_(all_derived_columns())
     {
         file_ = TFile::Open(input_name.c_str(), "READ");
         tree_ = dynamic_cast<TTree*>(file_->Get("emptyselectionfilter/StrangenessSelectionFilter"));
@@ -38,10 +57,22 @@ public:
         num_events_ = tree_->GetEntries();
 
         set_branch_addresses(); 
+        build_topology_columns();
+
+        if (!match_index_cache.empty())
+            open_match_index_cache(match_index_cache);
+
+        if (!derived_friend.empty())
+            add_derived_friend(derived_friend);
     }
 
     ~EventAssembler()
     {
+        if (cache_file_)
+        {
+            cache_file_->Close();
+            delete cache_file_;
+        }
         if (file_)
         {
             file_->Close();
@@ -51,12 +82,157 @@ public:
 
     const AnalysisEvent& get_event(int i) const
     {
-        tree_->GetEntry(i);
-        e_.category = categorise_event(e_);
+        read_entry(i);
+
+        if (cache_tree_)
+        {
+            cache_tree_->GetEntry(i);
+            cache_record_.restore(e_.match_index);
+        }
+        else if (build_match_index_)
+        {
+            build_match_index();
+        }
+        else
+        {
+            e_.match_index.clear();
+        }
+
+        DerivedColumnEngine::compute_event(e_, computed_columns_, e_.derived);
 
         return e_;
     }
 
+    void write_match_index_cache(const std::string& output_name) const
+    {
+        TFile output(output_name.c_str(), "RECREATE");
+        TTree cache_tree("MatchIndex", "Per-event truth-to-PFP match index");
+
+        MatchIndex::CacheRecord record;
+        record.set_output_branches(cache_tree);
+
+        for (int i = 0; i < num_events_; ++i)
+        {
+            record.store(get_event(i).match_index);
+            cache_tree.Fill();
+        }
+
+        cache_tree.Write();
+        output.Close();
+    }
+
+    // One row per event, aligned with the input tree so it can be added as a friend
+    void write_derived_friend(const std::string& output_name, const std::vector<DerivedColumn>& columns = all_derived_columns()) const
+    {
+        TFile output(output_name.c_str(), "RECREATE");
+        TTree friend_tree("DerivedKinematics", "Derived kinematic columns");
+
+        float values[kNumDerivedColumns] = {};
+        for (DerivedColumn c : columns)
+        {
+            std::string name = derived_column_names[c];
+            tree_utils::set_output_branch_address(friend_tree, name, &values[c], true, name + "/F");
+        }
+
+        // Raw entries only: the engine computes the columns once per batch,
+        // so get_event's per-event columns (and match index) would be wasted
+        const size_t batch_size = 1024;
+        DerivedColumnEngine engine(columns);
+        for (int i = 0; i < num_events_; ++i)
+        {
+            engine.add(read_entry(i));
+            if (engine.get_num_events() < batch_size && i + 1 < num_events_) continue;
+
+            engine.compute();
+            for (size_t j = 0; j < engine.get_num_events(); ++j)
+            {
+                for (DerivedColumn c : columns) values[c] = engine.get(c, j);
+                friend_tree.Fill();
+            }
+            engine.clear();
+        }
+
+        friend_tree.Write();
+        output.Close();
+    }
+
+    // Branches the match index is built from
+    static const std::vector<std::string>& get_match_index_branches()
+    {
+        static const std::vector<std::string> branches = {
+            "backtracked_tid", "pfnhits", "backtracked_purity", "backtracked_completeness",
+            "pfp_muon_purity", "pfp_muon_completeness", "pfp_piplus_purity",
+            "pfp_piplus_completeness", "pfp_piminus_purity", "pfp_piminus_completeness"
+        };
+        return branches;
+    }
+
+    // Read only the listed branches from now on; an empty list reads them
+    // all again. The match index is left empty unless its branches are
+    // listed or it comes from a cache. With a cache, match-index branches
+    // that are not listed stay off, but listed ones are read as usual.
+    void set_branch_projection(const std::vector<std::string>& branches) const
+    {
+        if (branches.empty())
+        {
+            tree_->SetBranchStatus("*", true);
+            build_match_index_ = true;
+        }
+        else
+        {
+            tree_->SetBranchStatus("*", false);
+            for (const std::string& branch : branches) tree_->SetBranchStatus(branch.c_str(), true);
+
+            build_match_index_ = true;
+            for (const std::string& branch : get_match_index_branches())
+            {
+                if (std::find(branches.begin(), branches.end(), branch) == branches.end()) build_match_index_ = false;
+            }
+
+            // Columns read from the derived friend stay on
+            for (DerivedColumn c : all_derived_columns())
+            {
+                if (std::find(computed_columns_.begin(), computed_columns_.end(), c) == computed_columns_.end())
+                    tree_->SetBranchStatus(derived_column_names[c], true);
+            }
+        }
+
+        disable_interned_branches();
+    }
+
+    // Ingest-time columns, available without reading the events
+    uint32_t get_topology(int i) const { return topology_[i]; }
+    EventCategory get_category(int i) const { return EventCategory(category_[i]); }
+    const std::vector<uint32_t>& get_topology_column() const { return topology_; }
+    const std::vector<unsigned char>& get_category_column() const { return category_; }
+
+    // End processes of the K0S daughter pions, as codes into a per-file dictionary
+    const std::vector<uint16_t>& get_piplus_end_process_column() const { return piplus_end_process_; }
+    const std::vector<uint16_t>& get_piminus_end_process_column() const { return piminus_end_process_; }
+    const StringDictionary& get_end_processes() const { return end_processes_; }
+    const std::string& get_end_process_name(uint16_t code) const { return end_processes_.get(code); }
+
+    // Entries with all of the required topology bits and none of the vetoed ones
+    std::vector<int> select_events(uint32_t required, uint32_t vetoed = 0) const
+    {
+        std::vector<int> entries;
+        for (int i = 0; i < num_events_; ++i)
+        {
+            if (has_topology(topology_[i], required, vetoed)) entries.push_back(i);
+        }
+        return entries;
+    }
+
+    std::vector<int> select_events(EventCategory category) const
+    {
+        std::vector<int> entries;
+        for (int i = 0; i < num_events_; ++i)
+        {
+            if (category_[i] == category) entries.push_back(i);
+        }
+        return entries;
+    }
+
     int get_num_events() const
     {
         return num_events_; 
@@ -78,6 +254,124 @@ private:
 
     AnalysisEvent e_;  
 
+    TFile* cache_file_;
+    TTree* cache_tree_;
+    mutable MatchIndex::CacheRecord cache_record_;
+    mutable bool build_match_index_;
+
+    std::vector<DerivedColumn> computed_columns_;
+
+    std::vector<uint32_t> topology_;
+    std::vector<unsigned char> category_;
+
+    StringDictionary end_processes_;
+    std::vector<uint16_t> piplus_end_process_;
+    std::vector<uint16_t> piminus_end_process_;
+    tree_utils::ManagedPointer<std::string> piplus_end_process_name_;
+    tree_utils::ManagedPointer<std::string> piminus_end_process_name_;
+
+    // The tree branches and ingest-time columns of entry i, without the
+    // match index or derived columns
+    const AnalysisEvent& read_entry(int i) const
+    {
+        EventArena::local().begin_entry(i);
+        tree_->GetEntry(i);
+        e_.topology = topology_[i];
+        e_.category = EventCategory(category_[i]);
+        e_.mc_kshrt_piplus_endprocess = piplus_end_process_[i];
+        e_.mc_kshrt_piminus_endprocess = piminus_end_process_[i];
+        return e_;
+    }
+
+    void build_match_index() const
+    {
+        e_.match_index.build(*e_.backtracked_tid, *e_.pfnhits, *e_.backtracked_purity, *e_.backtracked_completeness);
+
+        const std::vector<float>* purity[MatchIndex::kNumSignalParticles] = {
+            e_.pfp_muon_purity.get(), e_.pfp_piplus_purity.get(), e_.pfp_piminus_purity.get()
+        };
+        const std::vector<float>* completeness[MatchIndex::kNumSignalParticles] = {
+            e_.pfp_muon_completeness.get(), e_.pfp_piplus_completeness.get(), e_.pfp_piminus_completeness.get()
+        };
+        e_.match_index.build_signal(purity, completeness);
+    }
+
+    void open_match_index_cache(const std::string& cache_name)
+    {
+        cache_file_ = TFile::Open(cache_name.c_str(), "READ");
+        if (!cache_file_ || cache_file_->IsZombie())
+            throw std::invalid_argument("EventAssembler: cannot open match-index cache '" + cache_name + "'");
+
+        cache_tree_ = dynamic_cast<TTree*>(cache_file_->Get("MatchIndex"));
+        if (!cache_tree_)
+            throw std::invalid_argument("EventAssembler: '" + cache_name + "' has no MatchIndex tree");
+
+        // A cache written from another input would restore the wrong matches
+        if (cache_tree_->GetEntries() != num_events_)
+            throw std::invalid_argument("EventAssembler: match-index cache '" + cache_name + "' has " +
+                                        std::to_string(cache_tree_->GetEntries()) + " entries, input has " +
+                                        std::to_string(num_events_));
+
+        cache_record_.set_input_branches(*cache_tree_);
+    }
+
+    // One pass over only the truth branches the classifier needs, plus the
+    // end-process strings, which are interned here and not read again
+    void build_topology_columns()
+    {
+        tree_->SetBranchStatus("*", false);
+        for (const char* branch : {"nu_pdg", "ccnc", "interaction", "mc_pdg", "mc_has_muon", "mc_is_kshort_decay_pionic",
+                                   "mc_has_lambda", "mc_has_sigma_plus", "mc_has_sigma_minus", "mc_has_sigma_zero",
+                                   "mc_piplus_endprocess", "mc_piminus_endprocess"})
+        {
+            tree_->SetBranchStatus(branch, true);
+        }
+
+        topology_.resize(num_events_);
+        category_.resize(num_events_);
+        piplus_end_process_.resize(num_events_);
+        piminus_end_process_.resize(num_events_);
+        for (int i = 0; i < num_events_; ++i)
+        {
+            tree_->GetEntry(i);
+            topology_[i] = compute_truth_topology(e_);
+            category_[i] = (unsigned char)categorise_topology(topology_[i], e_.mc_nu_interaction_type);
+            piplus_end_process_[i] = intern_end_process(*piplus_end_process_name_);
+            piminus_end_process_[i] = intern_end_process(*piminus_end_process_name_);
+        }
+
+        tree_->SetBranchStatus("*", true);
+        disable_interned_branches();
+    }
+
+    uint16_t intern_end_process(const std::string& name)
+    {
+        uint32_t code = end_processes_.intern(name);
+        if (code > UINT16_MAX)
+            throw std::invalid_argument("EventAssembler: too many distinct end processes");
+        return uint16_t(code);
+    }
+
+    void disable_interned_branches() const
+    {
+        tree_->SetBranchStatus("mc_piplus_endprocess", false);
+        tree_->SetBranchStatus("mc_piminus_endprocess", false);
+    }
+
+    void add_derived_friend(const std::string& friend_name)
+    {
+        tree_->AddFriend("DerivedKinematics", friend_name.c_str());
+
+        computed_columns_.clear();
+        for (DerivedColumn c : all_derived_columns())
+        {
+            if (tree_->GetBranch(derived_column_names[c]))
+                tree_->SetBranchAddress(derived_column_names[c], &e_.derived.values[c]);
+            else
+                computed_columns_.push_back(c);
+        }
+    }
+
     void set_branch_addresses()
     {
         tree_->SetBranchAddress("evt", &e_.event);
@@ -159,8 +453,8 @@ private:
         tree_->SetBranchAddress("mc_piplus_n_inelas", &e_.mc_kshrt_piplus_n_inelas);
         tree_->SetBranchAddress("mc_piminus_n_inelas", &e_.mc_kshrt_piminus_n_inelas);
 
-        set_object_input_branch_address(*tree_, "mc_piplus_endprocess", e_.mc_kshrt_piplus_endprocess);
-        set_object_input_branch_address(*tree_, "mc_piminus_endprocess", e_.mc_kshrt_piminus_endprocess);
+        set_object_input_branch_address(*tree_, "mc_piplus_endprocess", piplus_end_process_name_);
+        set_object_input_branch_address(*tree_, "mc_piminus_endprocess", piminus_end_process_name_);
 
         tree_->SetBranchAddress("topological_score", &e_.topological_score);
         tree_->SetBranchAddress("reco_nu_vtx_sce_x", &e_.nu_vtx_x);
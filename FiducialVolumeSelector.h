@@ -4,15 +4,17 @@
 #include "TVector3.h"
 #include "AnalysisEvent.h"
 #include "Selector.h"
+#include "SpaceChargeMap.h"
 #include <vector>
 #include <cmath>
+#include <stdexcept>
 
 class FiducialVolumeSelector : public Selector {
 public:
     enum FiducialVolume { kOldFV, kWholeTPC, kWirecell, kWholeTPCPadded, kWirecellPadded };
 
     FiducialVolumeSelector(int version, double padding = 0.0) 
-        : version_(version), padding_(padding) 
+        : version_(version), padding_(padding), space_charge_(nullptr)
     {
         if (version_ == kWirecell || version_ == kWirecellPadded) 
         {
@@ -22,18 +24,41 @@ public:
 
     bool pass_selection(const AnalysisEvent& e) const override 
     {
-        TVector3 position(e.nu_vtx_x, e.nu_vtx_y, e.nu_vtx_z); 
-        return point_inside_fv(position);
+        return point_inside_fv(e.nu_vtx_x, e.nu_vtx_y, e.nu_vtx_z);
     }
 
     bool is_point_inside_fv(const TVector3& point) const
     {
-        return point_inside_fv(point);
+        return point_inside_fv(point.X(), point.Y(), point.Z());
+    }
+
+    // Used to correct points given in reconstructed (distorted) coordinates,
+    // such as reco_nu_vtx_x, before the volume test
+    void set_space_charge_map(const SpaceChargeMap* space_charge) { space_charge_ = space_charge; }
+
+    bool is_uncorrected_point_inside_fv(const TVector3& point) const
+    {
+        float x = point.X(), y = point.Y(), z = point.Z();
+        if (space_charge_) space_charge_->apply(SpaceChargeMap::kBackward, &x, &y, &z, 1);
+        return point_inside_fv(x, y, z);
+    }
+
+    // Batch test, inside[i] for (x[i], y[i], z[i]); the coordinates are
+    // corrected in one pass first when `uncorrected` is set
+    void are_points_inside_fv(std::vector<float> x, std::vector<float> y, std::vector<float> z, bool uncorrected, std::vector<char>& inside) const
+    {
+        if (uncorrected && space_charge_) space_charge_->apply(SpaceChargeMap::kBackward, x, y, z);
+        if (x.size() != y.size() || x.size() != z.size())
+            throw std::invalid_argument("FiducialVolumeSelector: coordinate arrays differ in length");
+
+        inside.resize(x.size());
+        for (size_t i = 0; i < x.size(); ++i) inside[i] = point_inside_fv(x[i], y[i], z[i]);
     }
 
 private:
     int version_;
     double padding_;
+    const SpaceChargeMap* space_charge_;
 
     // TPC boundaries and constants
     const double tpc_xmin_ = -1.55;
@@ -132,64 +157,64 @@ private:
         return c;
     }
 
-    bool point_inside_fv(const TVector3& position) const 
+    bool point_inside_fv(double x, double y, double z) const 
     {
         switch (version_) 
         {
             case kOldFV:
-                return point_inside_old_fv(position);
+                return point_inside_old_fv(x, y, z);
             case kWholeTPC:
             case kWholeTPCPadded:
-                return point_inside_whole_tpc_padded(position);
+                return point_inside_whole_tpc_padded(x, y, z);
             case kWirecell:
-                return point_inside_wirecell(position);
+                return point_inside_wirecell(x, y, z);
             case kWirecellPadded:
-                return point_inside_wirecell_padded(position);
+                return point_inside_wirecell_padded(x, y, z);
             default:
                 return false;
         }
     }
 
-    bool point_inside_old_fv(const TVector3& position) const 
+    bool point_inside_old_fv(double x, double y, double z) const 
     {
-        if (position.X() > tpc_xmax_ || position.X() < tpc_xmin_) return false;
-        if (position.Y() > tpc_ymax_ || position.Y() < tpc_ymin_) return false;
-        if (position.Z() > tpc_zmax_ || position.Z() < tpc_zmin_) return false;
-        if (position.Z() < deadz_max_ && position.Z() > deadz_min_) return false;
+        if (x > tpc_xmax_ || x < tpc_xmin_) return false;
+        if (y > tpc_ymax_ || y < tpc_ymin_) return false;
+        if (z > tpc_zmax_ || z < tpc_zmin_) return false;
+        if (z < deadz_max_ && z > deadz_min_) return false;
         return true;
     }
 
-    bool point_inside_whole_tpc_padded(const TVector3& position) const 
+    bool point_inside_whole_tpc_padded(double x, double y, double z) const 
     {
-        if (position.X() > tpc_xmax_ - padding_ || position.X() < tpc_xmin_ + padding_) return false;
-        if (position.Y() > tpc_ymax_ - padding_ || position.Y() < tpc_ymin_ + padding_) return false;
-        if (position.Z() > tpc_zmax_ - padding_ || position.Z() < tpc_zmin_ + padding_) return false;
-        if (position.Z() < deadz_max_ && position.Z() > deadz_min_) return false;
+        if (x > tpc_xmax_ - padding_ || x < tpc_xmin_ + padding_) return false;
+        if (y > tpc_ymax_ - padding_ || y < tpc_ymin_ + padding_) return false;
+        if (z > tpc_zmax_ - padding_ || z < tpc_zmin_ + padding_) return false;
+        if (z < deadz_max_ && z > deadz_min_) return false;
         return true;
     }
 
-    bool point_inside_wirecell(const TVector3& position) const 
+    bool point_inside_wirecell(double x, double y, double z) const 
     {
-        if (position.Z() > 1000 || position.Z() < 0) return false;
-        if (position.Z() < deadz_max_ && position.Z() > deadz_min_) return false;
+        if (z > 1000 || z < 0) return false;
+        if (z < deadz_max_ && z > deadz_min_) return false;
 
         int c1 = 0, c2 = 0;
-        int index_y = floor((position.Y() + 116) / 24);
-        int index_z = floor(position.Z() / 100);
+        int index_y = floor((y + 116) / 24);
+        int index_z = floor(z / 100);
         if (index_y < 0) index_y = 0;
         else if (index_y > 9) index_y = 9;
         if (index_z < 0) index_z = 0;
         else if (index_z > 9) index_z = 9;
 
-        c1 = pnpoly(boundary_xy_x_array_[index_z], boundary_xy_y_array_[index_z], position.X(), position.Y());
-        c2 = pnpoly(boundary_xz_x_array_[index_y], boundary_xz_z_array_[index_y], position.X(), position.Z());
+        c1 = pnpoly(boundary_xy_x_array_[index_z], boundary_xy_y_array_[index_z], x, y);
+        c2 = pnpoly(boundary_xz_x_array_[index_y], boundary_xz_z_array_[index_y], x, z);
 
         return c1 && c2;
     }
 
-    bool point_inside_wirecell_padded(const TVector3& position) const 
+    bool point_inside_wirecell_padded(double x, double y, double z) const 
     {
-        return point_inside_wirecell(position) && point_inside_whole_tpc_padded(position);
+        return point_inside_wirecell(x, y, z) && point_inside_whole_tpc_padded(x, y, z);
     }
 };
 
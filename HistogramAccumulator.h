@@ -0,0 +1,336 @@
+#ifndef HISTOGRAMACCUMULATOR_H
+#define HISTOGRAMACCUMULATOR_H
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "TH1D.h"
+#include "TH2D.h"
+
+// Bin edges with the lookup precomputed for the binning type: uniform and
+// log binning find the bin arithmetically, variable binning by bisection.
+// Bin 0 is underflow and bin n_bins + 1 is overflow, as in ROOT.
+class Binning
+{
+public:
+    static Binning uniform(int n_bins, double x_min, double x_max)
+    {
+        if (n_bins <= 0 || !(x_max > x_min))
+            throw std::invalid_argument("Binning: invalid uniform binning");
+
+        Binning binning(kUniform);
+        binning.offset_ = x_min;
+        binning.scale_ = n_bins / (x_max - x_min);
+        for (int i = 0; i <= n_bins; ++i) binning.edges_.push_back(x_min + i * (x_max - x_min) / n_bins);
+        return binning;
+    }
+
+    static Binning logarithmic(int n_bins, double x_min, double x_max)
+    {
+        if (n_bins <= 0 || !(x_min > 0) || !(x_max > x_min))
+            throw std::invalid_argument("Binning: invalid logarithmic binning");
+
+        Binning binning(kLogarithmic);
+        binning.offset_ = std::log(x_min);
+        binning.scale_ = n_bins / (std::log(x_max) - std::log(x_min));
+        for (int i = 0; i <= n_bins; ++i) binning.edges_.push_back(x_min * std::pow(x_max / x_min, double(i) / n_bins));
+        return binning;
+    }
+
+    static Binning variable(const std::vector<double>& edges)
+    {
+        if (edges.size() < 2 || !std::is_sorted(edges.begin(), edges.end()) ||
+            std::adjacent_find(edges.begin(), edges.end()) != edges.end())
+            throw std::invalid_argument("Binning: edges must be strictly increasing");
+
+        Binning binning(kVariable);
+        binning.edges_ = edges;
+        return binning;
+    }
+
+    int find_bin(double x) const
+    {
+        int n_bins = get_num_bins();
+        if (!(x >= edges_.front())) return 0;
+        if (x >= edges_.back()) return n_bins + 1;
+
+        int bin;
+        if (type_ == kVariable)
+            return int(std::upper_bound(edges_.begin(), edges_.end(), x) - edges_.begin());
+        else if (type_ == kUniform)
+            bin = 1 + int((x - offset_) * scale_);
+        else
+            bin = 1 + int((std::log(x) - offset_) * scale_);
+
+        // Rounding at an edge can land one bin off
+        if (bin > n_bins) bin = n_bins;
+        if (x < edges_[bin - 1]) --bin;
+        else if (x >= edges_[bin]) ++bin;
+        return bin;
+    }
+
+    int get_num_bins() const { return int(edges_.size()) - 1; }
+    const std::vector<double>& get_edges() const { return edges_; }
+
+    bool operator==(const Binning& other) const { return edges_ == other.edges_; }
+    bool operator!=(const Binning& other) const { return !(*this == other); }
+
+private:
+    enum Type { kUniform, kLogarithmic, kVariable };
+
+    Binning(Type type) : type_(type), offset_(0.0), scale_(0.0) {}
+
+    Type type_;
+    double offset_;
+    double scale_;
+    std::vector<double> edges_;
+};
+
+// Sum of weights and of squared weights in one flat array each. Not
+// registered with any ROOT directory; converted to TH1D only at the end.
+class Histogram1D
+{
+public:
+    Histogram1D(const Binning& binning)
+        : binning_(binning), sum_w_(binning.get_num_bins() + 2, 0.0), sum_w2_(binning.get_num_bins() + 2, 0.0), entries_(0) {}
+
+    void fill(double x, double w = 1.0)
+    {
+        int bin = binning_.find_bin(x);
+        sum_w_[bin] += w;
+        sum_w2_[bin] += w * w;
+        entries_++;
+    }
+
+    // Weights default to one
+    void fill_n(size_t n, const double* x, const double* w = nullptr)
+    {
+        for (size_t i = 0; i < n; ++i) fill(x[i], w ? w[i] : 1.0);
+    }
+
+    void fill_n(size_t n, const float* x, const float* w = nullptr)
+    {
+        for (size_t i = 0; i < n; ++i) fill(x[i], w ? w[i] : 1.0);
+    }
+
+    void merge(const Histogram1D& other)
+    {
+        if (other.binning_ != binning_)
+            throw std::invalid_argument("Histogram1D: cannot merge histograms with different binning");
+
+        for (size_t b = 0; b < sum_w_.size(); ++b) {
+            sum_w_[b] += other.sum_w_[b];
+            sum_w2_[b] += other.sum_w2_[b];
+        }
+        entries_ += other.entries_;
+    }
+
+    void reset()
+    {
+        std::fill(sum_w_.begin(), sum_w_.end(), 0.0);
+        std::fill(sum_w2_.begin(), sum_w2_.end(), 0.0);
+        entries_ = 0;
+    }
+
+    // Caller owns the returned histogram
+    TH1D* to_th1d(const std::string& name, const std::string& title) const
+    {
+        const std::vector<double>& edges = binning_.get_edges();
+        TH1D* hist = new TH1D(name.c_str(), title.c_str(), binning_.get_num_bins(), edges.data());
+        hist->SetDirectory(nullptr);
+        hist->Sumw2();
+        for (size_t b = 0; b < sum_w_.size(); ++b) {
+            hist->SetBinContent(int(b), sum_w_[b]);
+            hist->SetBinError(int(b), std::sqrt(sum_w2_[b]));
+        }
+        hist->SetEntries(double(entries_));
+        return hist;
+    }
+
+    // Overwrite the sums, e.g. with a snapshot of shared bins
+    void set_contents(const std::vector<double>& sum_w, const std::vector<double>& sum_w2, long entries)
+    {
+        if (sum_w.size() != sum_w_.size() || sum_w2.size() != sum_w2_.size())
+            throw std::invalid_argument("Histogram1D: contents do not match the binning");
+
+        sum_w_ = sum_w;
+        sum_w2_ = sum_w2;
+        entries_ = entries;
+    }
+
+    double get_bin_content(int bin) const { return sum_w_.at(bin); }
+    double get_bin_error(int bin) const { return std::sqrt(sum_w2_.at(bin)); }
+    long get_entries() const { return entries_; }
+    const Binning& get_binning() const { return binning_; }
+
+private:
+    Binning binning_;
+    std::vector<double> sum_w_;
+    std::vector<double> sum_w2_;
+    long entries_;
+};
+
+// Row-major over (x, y) including under- and overflow on both axes
+class Histogram2D
+{
+public:
+    Histogram2D(const Binning& binning_x, const Binning& binning_y)
+        : binning_x_(binning_x), binning_y_(binning_y), stride_(binning_x.get_num_bins() + 2),
+          sum_w_(size_t(stride_) * (binning_y.get_num_bins() + 2), 0.0), sum_w2_(sum_w_.size(), 0.0), entries_(0) {}
+
+    void fill(double x, double y, double w = 1.0)
+    {
+        size_t cell = size_t(binning_y_.find_bin(y)) * stride_ + binning_x_.find_bin(x);
+        sum_w_[cell] += w;
+        sum_w2_[cell] += w * w;
+        entries_++;
+    }
+
+    void fill_n(size_t n, const double* x, const double* y, const double* w = nullptr)
+    {
+        for (size_t i = 0; i < n; ++i) fill(x[i], y[i], w ? w[i] : 1.0);
+    }
+
+    void fill_n(size_t n, const float* x, const float* y, const float* w = nullptr)
+    {
+        for (size_t i = 0; i < n; ++i) fill(x[i], y[i], w ? w[i] : 1.0);
+    }
+
+    void merge(const Histogram2D& other)
+    {
+        if (other.binning_x_ != binning_x_ || other.binning_y_ != binning_y_)
+            throw std::invalid_argument("Histogram2D: cannot merge histograms with different binning");
+
+        for (size_t c = 0; c < sum_w_.size(); ++c) {
+            sum_w_[c] += other.sum_w_[c];
+            sum_w2_[c] += other.sum_w2_[c];
+        }
+        entries_ += other.entries_;
+    }
+
+    void reset()
+    {
+        std::fill(sum_w_.begin(), sum_w_.end(), 0.0);
+        std::fill(sum_w2_.begin(), sum_w2_.end(), 0.0);
+        entries_ = 0;
+    }
+
+    // Caller owns the returned histogram
+    TH2D* to_th2d(const std::string& name, const std::string& title) const
+    {
+        const std::vector<double>& edges_x = binning_x_.get_edges();
+        const std::vector<double>& edges_y = binning_y_.get_edges();
+        TH2D* hist = new TH2D(name.c_str(), title.c_str(), binning_x_.get_num_bins(), edges_x.data(), binning_y_.get_num_bins(), edges_y.data());
+        hist->SetDirectory(nullptr);
+        hist->Sumw2();
+        for (int by = 0; by <= binning_y_.get_num_bins() + 1; ++by) {
+            for (int bx = 0; bx < stride_; ++bx) {
+                size_t cell = size_t(by) * stride_ + bx;
+                hist->SetBinContent(bx, by, sum_w_[cell]);
+                hist->SetBinError(bx, by, std::sqrt(sum_w2_[cell]));
+            }
+        }
+        hist->SetEntries(double(entries_));
+        return hist;
+    }
+
+    double get_bin_content(int bin_x, int bin_y) const { return sum_w_.at(size_t(bin_y) * stride_ + bin_x); }
+    long get_entries() const { return entries_; }
+
+private:
+    Binning binning_x_;
+    Binning binning_y_;
+    int stride_;
+    std::vector<double> sum_w_;
+    std::vector<double> sum_w2_;
+    long entries_;
+};
+
+// One private copy of a histogram per worker: each thread fills its own
+// slot without synchronisation and the copies are summed once at the end
+template <typename H> class ThreadLocalHistogram
+{
+public:
+    ThreadLocalHistogram(const H& prototype, int n_threads)
+    {
+        if (n_threads <= 0)
+            throw std::invalid_argument("ThreadLocalHistogram: need at least one thread");
+
+        // Each copy on its own heap block so neighbouring threads do not share cache lines
+        for (int t = 0; t < n_threads; ++t) copies_.emplace_back(new H(prototype));
+    }
+
+    H& local(int thread) { return *copies_.at(thread); }
+
+    H merge() const
+    {
+        H result(*copies_[0]);
+        for (size_t t = 1; t < copies_.size(); ++t) result.merge(*copies_[t]);
+        return result;
+    }
+
+    int get_num_threads() const { return int(copies_.size()); }
+
+private:
+    std::vector<std::unique_ptr<H>> copies_;
+};
+
+// Shared bins updated with atomic compare-and-swap, for fills too sparse to
+// justify a copy per thread
+class AtomicHistogram1D
+{
+public:
+    AtomicHistogram1D(const Binning& binning)
+        : binning_(binning), sum_w_(binning.get_num_bins() + 2), sum_w2_(binning.get_num_bins() + 2), entries_(0)
+    {
+        for (size_t b = 0; b < sum_w_.size(); ++b) {
+            sum_w_[b].store(0.0);
+            sum_w2_[b].store(0.0);
+        }
+    }
+
+    void fill(double x, double w = 1.0)
+    {
+        int bin = binning_.find_bin(x);
+        add(sum_w_[bin], w);
+        add(sum_w2_[bin], w * w);
+        entries_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void fill_n(size_t n, const double* x, const double* w = nullptr)
+    {
+        for (size_t i = 0; i < n; ++i) fill(x[i], w ? w[i] : 1.0);
+    }
+
+    // Snapshot into a plain histogram, e.g. once the workers have joined
+    Histogram1D to_histogram() const
+    {
+        Histogram1D hist(binning_);
+        std::vector<double> contents(sum_w_.size()), errors2(sum_w2_.size());
+        for (size_t b = 0; b < sum_w_.size(); ++b) {
+            contents[b] = sum_w_[b].load();
+            errors2[b] = sum_w2_[b].load();
+        }
+        hist.set_contents(contents, errors2, entries_.load());
+        return hist;
+    }
+
+private:
+    Binning binning_;
+    std::vector<std::atomic<double>> sum_w_;
+    std::vector<std::atomic<double>> sum_w2_;
+    std::atomic<long> entries_;
+
+    static void add(std::atomic<double>& target, double value)
+    {
+        double expected = target.load(std::memory_order_relaxed);
+        while (!target.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed)) {}
+    }
+};
+
+#endif // HISTOGRAMACCUMULATOR_H
@@ -0,0 +1,281 @@
+#ifndef HISTOGRAMCACHE_H
+#define HISTOGRAMCACHE_H
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TH1D.h"
+#include "TEfficiency.h"
+
+#include "TreeUtilities.h"
+#include "HistogramAccumulator.h"
+
+// Fine-binned base histograms and efficiency numerator/denominator pairs,
+// filled once in the event loop and written to a results file. A separate
+// plotting stage reads the file back and rebins or restricts the range as
+// needed, so changing an axis does not mean another pass over the events.
+class HistogramCache
+{
+public:
+    enum Kind { kHistogram = 0, kEfficiency = 1 };
+
+    int book(const std::string& name, const std::string& title, int n_bins, double x_min, double x_max)
+    {
+        return add_entry(name, title, kHistogram, n_bins, x_min, x_max);
+    }
+
+    int book_efficiency(const std::string& name, const std::string& title, int n_bins, double x_min, double x_max)
+    {
+        return add_entry(name, title, kEfficiency, n_bins, x_min, x_max);
+    }
+
+    void fill(int id, double x, double w = 1.0)
+    {
+        entries_[id].total.fill(x, w);
+    }
+
+    void fill_efficiency(int id, double x, bool passed, double w = 1.0)
+    {
+        Entry& entry = entries_[id];
+        entry.total.fill(x, w);
+        if (passed) entry.passed.fill(x, w);
+    }
+
+    void merge(const HistogramCache& other)
+    {
+        if (other.entries_.size() != entries_.size())
+            throw std::invalid_argument("HistogramCache: cannot merge caches with different contents");
+
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (other.entries_[i].name != entries_[i].name)
+                throw std::invalid_argument("HistogramCache: cannot merge caches with different contents");
+            entries_[i].total.merge(other.entries_[i].total);
+            entries_[i].passed.merge(other.entries_[i].passed);
+        }
+    }
+
+    void write(const std::string& output_name) const
+    {
+        TFile output(output_name.c_str(), "RECREATE");
+        TTree index("histogram_cache_index", "Fine-binned histogram cache");
+
+        tree_utils::ManagedPointer<std::string> name;
+        tree_utils::ManagedPointer<std::string> title;
+        int kind, n_bins;
+        double x_min, x_max;
+        tree_utils::set_object_output_branch_address(index, "name", name, true);
+        tree_utils::set_object_output_branch_address(index, "title", title, true);
+        tree_utils::set_output_branch_address(index, "kind", &kind, true, "kind/I");
+        tree_utils::set_output_branch_address(index, "n_bins", &n_bins, true, "n_bins/I");
+        tree_utils::set_output_branch_address(index, "x_min", &x_min, true, "x_min/D");
+        tree_utils::set_output_branch_address(index, "x_max", &x_max, true, "x_max/D");
+
+        for (const Entry& entry : entries_) {
+            *name = entry.name;
+            *title = entry.title;
+            kind = entry.kind;
+            n_bins = entry.n_bins;
+            x_min = entry.x_min;
+            x_max = entry.x_max;
+            index.Fill();
+
+            std::unique_ptr<TH1D> total(entry.total.to_th1d(entry.name + "_total", entry.title));
+            total->Write();
+            if (entry.kind == kEfficiency) {
+                std::unique_ptr<TH1D> passed(entry.passed.to_th1d(entry.name + "_passed", entry.title));
+                passed->Write();
+            }
+        }
+
+        index.Write();
+        output.Close();
+    }
+
+    static HistogramCache read(const std::string& input_name)
+    {
+        HistogramCache cache;
+
+        std::unique_ptr<TFile> input(TFile::Open(input_name.c_str(), "READ"));
+        if (!input || input->IsZombie())
+            throw std::invalid_argument("HistogramCache: cannot open '" + input_name + "'");
+
+        TTree* index = dynamic_cast<TTree*>(input->Get("histogram_cache_index"));
+        if (!index)
+            throw std::invalid_argument("HistogramCache: '" + input_name + "' has no cache index");
+
+        tree_utils::ManagedPointer<std::string> name;
+        tree_utils::ManagedPointer<std::string> title;
+        int kind, n_bins;
+        double x_min, x_max;
+        tree_utils::set_object_input_branch_address(*index, "name", name);
+        tree_utils::set_object_input_branch_address(*index, "title", title);
+        index->SetBranchAddress("kind", &kind);
+        index->SetBranchAddress("n_bins", &n_bins);
+        index->SetBranchAddress("x_min", &x_min);
+        index->SetBranchAddress("x_max", &x_max);
+
+        for (long long i = 0; i < index->GetEntries(); ++i) {
+            index->GetEntry(i);
+            int id = cache.add_entry(*name, *title, Kind(kind), n_bins, x_min, x_max);
+            Entry& entry = cache.entries_[id];
+            restore(*input, *name + "_total", entry.total);
+            if (entry.kind == kEfficiency) restore(*input, *name + "_passed", entry.passed);
+        }
+
+        input->Close();
+        return cache;
+    }
+
+    // Merge groups of n_merge fine bins over [x_min, x_max), widened to the
+    // nearest fine edges. Caller owns the returned object.
+    TH1D* get_histogram(const std::string& name, int n_merge = 1,
+                        double x_min = std::numeric_limits<double>::lowest(), double x_max = std::numeric_limits<double>::max()) const
+    {
+        const Entry& entry = get_entry(name, kHistogram);
+        return get_histogram(name, coarse_edges(entry.total.get_binning(), n_merge, x_min, x_max));
+    }
+
+    // Fine bins are assigned to the coarse bin holding their centre
+    TH1D* get_histogram(const std::string& name, const std::vector<double>& edges) const
+    {
+        const Entry& entry = get_entry(name, kHistogram);
+        return rebin(entry.total, edges).to_th1d(name, entry.title);
+    }
+
+    TEfficiency* get_efficiency(const std::string& name, int n_merge = 1,
+                                double x_min = std::numeric_limits<double>::lowest(), double x_max = std::numeric_limits<double>::max()) const
+    {
+        const Entry& entry = get_entry(name, kEfficiency);
+        return get_efficiency(name, coarse_edges(entry.total.get_binning(), n_merge, x_min, x_max));
+    }
+
+    TEfficiency* get_efficiency(const std::string& name, const std::vector<double>& edges) const
+    {
+        const Entry& entry = get_entry(name, kEfficiency);
+        std::unique_ptr<TH1D> passed(rebin(entry.passed, edges).to_th1d(name + "_passed", entry.title));
+        std::unique_ptr<TH1D> total(rebin(entry.total, edges).to_th1d(name + "_total", entry.title));
+
+        TEfficiency* effic = new TEfficiency(*passed, *total);
+        effic->SetName(name.c_str());
+        effic->SetTitle(entry.title.c_str());
+        return effic;
+    }
+
+    std::vector<std::string> get_names(Kind kind) const
+    {
+        std::vector<std::string> names;
+        for (const Entry& entry : entries_) {
+            if (entry.kind == kind) names.push_back(entry.name);
+        }
+        return names;
+    }
+
+    const std::string& get_title(const std::string& name) const { return find(name).title; }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string title;
+        Kind kind;
+        int n_bins;
+        double x_min, x_max;
+        Histogram1D total;
+        Histogram1D passed;
+    };
+
+    std::vector<Entry> entries_;
+
+    int add_entry(const std::string& name, const std::string& title, Kind kind, int n_bins, double x_min, double x_max)
+    {
+        for (const Entry& entry : entries_) {
+            if (entry.name == name)
+                throw std::invalid_argument("HistogramCache: '" + name + "' is already booked");
+        }
+
+        Binning binning = Binning::uniform(n_bins, x_min, x_max);
+        entries_.push_back({name, title, kind, n_bins, x_min, x_max, Histogram1D(binning), Histogram1D(binning)});
+        return int(entries_.size()) - 1;
+    }
+
+    const Entry& find(const std::string& name) const
+    {
+        for (const Entry& entry : entries_) {
+            if (entry.name == name) return entry;
+        }
+        throw std::invalid_argument("HistogramCache: unknown entry '" + name + "'");
+    }
+
+    const Entry& get_entry(const std::string& name, Kind kind) const
+    {
+        const Entry& entry = find(name);
+        if (entry.kind != kind)
+            throw std::invalid_argument("HistogramCache: '" + name + "' is not of the requested kind");
+        return entry;
+    }
+
+    static void restore(TFile& input, const std::string& name, Histogram1D& hist)
+    {
+        TH1D* stored = dynamic_cast<TH1D*>(input.Get(name.c_str()));
+        if (!stored)
+            throw std::invalid_argument("HistogramCache: missing histogram '" + name + "'");
+
+        int n = hist.get_binning().get_num_bins() + 2;
+        std::vector<double> sum_w(n), sum_w2(n);
+        for (int b = 0; b < n; ++b) {
+            sum_w[b] = stored->GetBinContent(b);
+            sum_w2[b] = stored->GetBinError(b) * stored->GetBinError(b);
+        }
+        hist.set_contents(sum_w, sum_w2, long(stored->GetEntries()));
+    }
+
+    static std::vector<double> coarse_edges(const Binning& fine, int n_merge, double x_min, double x_max)
+    {
+        if (n_merge <= 0 || !(x_max > x_min))
+            throw std::invalid_argument("HistogramCache: invalid rebinning");
+
+        const std::vector<double>& edges = fine.get_edges();
+        int n = fine.get_num_bins();
+        int first = std::max(0, std::min(n - 1, fine.find_bin(x_min) - 1));
+
+        std::vector<double> coarse = {edges[first]};
+        for (int k = first; k < n && edges[k] < x_max;) {
+            k = std::min(n, k + n_merge);
+            coarse.push_back(edges[k]);
+        }
+        return coarse;
+    }
+
+    static Histogram1D rebin(const Histogram1D& fine, const std::vector<double>& edges)
+    {
+        const Binning& fine_binning = fine.get_binning();
+        const std::vector<double>& fine_edges = fine_binning.get_edges();
+        Binning coarse_binning = Binning::variable(edges);
+        int n_fine = fine_binning.get_num_bins();
+        int n_coarse = coarse_binning.get_num_bins();
+
+        std::vector<double> sum_w(n_coarse + 2, 0.0), sum_w2(n_coarse + 2, 0.0);
+        for (int b = 0; b <= n_fine + 1; ++b) {
+            int target;
+            if (b == 0) target = 0;
+            else if (b == n_fine + 1) target = n_coarse + 1;
+            else target = coarse_binning.find_bin(0.5 * (fine_edges[b - 1] + fine_edges[b]));
+
+            double error = fine.get_bin_error(b);
+            sum_w[target] += fine.get_bin_content(b);
+            sum_w2[target] += error * error;
+        }
+
+        Histogram1D coarse(coarse_binning);
+        coarse.set_contents(sum_w, sum_w2, fine.get_entries());
+        return coarse;
+    }
+};
+
+#endif // HISTOGRAMCACHE_H
@@ -0,0 +1,184 @@
+#ifndef HITCLUSTERING_H
+#define HITCLUSTERING_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <memory_resource>
+
+#include "Constants.h"
+#include "HitGrid.h"
+#include "EventArena.h"
+#include "DisplayAssembler.h"
+
+// Summary of one density cluster on one plane. Wires are wire numbers,
+// drift and distances are cm (wire offsets scaled by the wire pitch).
+struct HitCluster
+{
+    int plane;
+    int n_hits;
+    float wire_min, wire_max;
+    float drift_min, drift_max;
+    float centroid_wire, centroid_drift;
+    float vertex_distance;           // closest hit to the vertex: the gap for displaced activity
+    float centroid_vertex_distance;
+};
+
+// DBSCAN over wire-drift hits. Neighbourhoods come from a HitGrid with
+// cells of size epsilon, so each query reads at most nine cells and the
+// cost is near-linear in the number of hits at fixed density. A hit is core
+// if at least min_points hits (itself included) lie within epsilon cm.
+class HitClusterer
+{
+public:
+    static constexpr int kNoise = -1;
+
+    HitClusterer(float epsilon = 1.0, int min_points = 4)
+        : epsilon_(epsilon), min_points_(min_points)
+    {
+        if (epsilon <= 0 || min_points < 1)
+            throw std::invalid_argument("HitClusterer: epsilon must be positive and min_points at least 1");
+    }
+
+    float get_epsilon() const { return epsilon_; }
+    int get_min_points() const { return min_points_; }
+
+    // Cluster label of every hit (kNoise for noise); returns the cluster count
+    int cluster(const float* wire, const float* drift, size_t n, std::vector<int>& labels) const
+    {
+        labels.assign(n, kUnvisited);
+        if (n == 0) return 0;
+
+        HitGrid grid(wire, drift, n, epsilon_);
+        std::vector<int> neighbours, frontier;
+        int n_clusters = 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            if (labels[i] != kUnvisited) continue;
+
+            neighbours.clear();
+            grid.query_radius(wire[i], drift[i], epsilon_, neighbours);
+            if (int(neighbours.size()) < min_points_) {
+                labels[i] = kNoise;
+                continue;
+            }
+
+            // Grow a new cluster breadth-first from this core hit
+            int id = n_clusters++;
+            labels[i] = id;
+            frontier.assign(neighbours.begin(), neighbours.end());
+            while (!frontier.empty()) {
+                int j = frontier.back();
+                frontier.pop_back();
+                if (labels[j] == kNoise) labels[j] = id;  // border hit
+                if (labels[j] != kUnvisited) continue;
+                labels[j] = id;
+
+                neighbours.clear();
+                grid.query_radius(wire[j], drift[j], epsilon_, neighbours);
+                if (int(neighbours.size()) >= min_points_) {
+                    for (int m : neighbours) {
+                        if (labels[m] == kUnvisited || labels[m] == kNoise) frontier.push_back(m);
+                    }
+                }
+            }
+        }
+
+        return n_clusters;
+    }
+
+    std::vector<HitCluster> summarise(int plane, const float* wire, const float* drift, const std::vector<int>& labels,
+                                      int n_clusters, float vertex_wire, float vertex_drift, float wire_pitch = WIRE_PITCH) const
+    {
+        const float inf = std::numeric_limits<float>::max();
+        std::vector<HitCluster> clusters(n_clusters, HitCluster{ plane, 0, inf, -inf, inf, -inf, 0, 0, inf, 0 });
+
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (labels[i] < 0) continue;
+            HitCluster& c = clusters[labels[i]];
+            c.n_hits++;
+            c.wire_min = std::min(c.wire_min, wire[i]);
+            c.wire_max = std::max(c.wire_max, wire[i]);
+            c.drift_min = std::min(c.drift_min, drift[i]);
+            c.drift_max = std::max(c.drift_max, drift[i]);
+            c.centroid_wire += wire[i];
+            c.centroid_drift += drift[i];
+            c.vertex_distance = std::min(c.vertex_distance, distance(wire[i], drift[i], vertex_wire, vertex_drift, wire_pitch));
+        }
+
+        for (HitCluster& c : clusters) {
+            c.centroid_wire /= c.n_hits;
+            c.centroid_drift /= c.n_hits;
+            c.centroid_vertex_distance = distance(c.centroid_wire, c.centroid_drift, vertex_wire, vertex_drift, wire_pitch);
+        }
+        return clusters;
+    }
+
+    // One plane of the entry loaded in the assembler; distances are to the
+    // true vertex for true hits and to the reco vertex for slice hits
+    std::vector<HitCluster> cluster_plane(const DisplayAssembler& assembler, int plane, DisplayAssembler::HitSource source) const
+    {
+        DisplayAssembler::PlaneHits hits = assembler.get_plane(plane);
+        std::pmr::memory_resource* arena = EventArena::local().resource();
+        std::pmr::vector<float> wires(arena), drifts(arena);
+        if (source == DisplayAssembler::kTrueHits) {
+            wires.assign(hits.wire->begin(), hits.wire->end());
+            drifts.assign(hits.drift->begin(), hits.drift->end());
+        }
+        else {
+            assembler.get_slice_hits(plane, wires, drifts);
+        }
+
+        bool use_true = source == DisplayAssembler::kTrueHits;
+        std::vector<int>& labels = labels_buffer();
+        int n_clusters = cluster(wires.data(), drifts.data(), wires.size(), labels);
+        return summarise(plane, wires.data(), drifts.data(), labels, n_clusters,
+                         use_true ? hits.true_vertex_wire : hits.reco_vertex_wire,
+                         use_true ? hits.true_vertex_drift : hits.reco_vertex_drift);
+    }
+
+    // All planes of one entry, U then V then W
+    std::vector<HitCluster> cluster_event(const DisplayAssembler& assembler, int entry, DisplayAssembler::HitSource source) const
+    {
+        assembler.load_event(entry);
+        std::vector<HitCluster> clusters;
+        for (int plane = 0; plane < 3; ++plane) {
+            std::vector<HitCluster> found = cluster_plane(assembler, plane, source);
+            clusters.insert(clusters.end(), found.begin(), found.end());
+        }
+        return clusters;
+    }
+
+    // Batch over entries: result[k] holds the clusters of entries[k]
+    std::vector<std::vector<HitCluster>> cluster_events(const DisplayAssembler& assembler, const std::vector<int>& entries,
+                                                        DisplayAssembler::HitSource source) const
+    {
+        std::vector<std::vector<HitCluster>> result;
+        result.reserve(entries.size());
+        for (int entry : entries) result.push_back(cluster_event(assembler, entry, source));
+        return result;
+    }
+
+private:
+    static constexpr int kUnvisited = -2;
+
+    float epsilon_;
+    int min_points_;
+
+    // Reused across events on each thread
+    static std::vector<int>& labels_buffer()
+    {
+        thread_local std::vector<int> labels;
+        return labels;
+    }
+
+    static float distance(float wire_a, float drift_a, float wire_b, float drift_b, float wire_pitch)
+    {
+        float dw = (wire_a - wire_b) * wire_pitch, dd = drift_a - drift_b;
+        return std::sqrt(dw * dw + dd * dd);
+    }
+};
+
+#endif // HITCLUSTERING_H
@@ -0,0 +1,240 @@
+#ifndef HITGRID_H
+#define HITGRID_H
+
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+#include "Constants.h"
+#include "MatchKernels.h"
+
+// Uniform-grid index over one plane's hits for radius, box and k-nearest
+// queries. Hits are given as (wire, drift) and indexed in cm, with the wire
+// number scaled by the wire pitch so that distances are isotropic.
+// Points are stored in cell order (a counting sort), so a query touches a
+// few contiguous runs instead of the whole hit list. Results are indices
+// into the input arrays.
+class HitGrid
+{
+public:
+    HitGrid(const float* wire, const float* drift, size_t n, float cell_size = 2.0, float wire_pitch = WIRE_PITCH)
+        : pitch_(wire_pitch), cell_(cell_size), nx_(1), ny_(1), x0_(0), y0_(0)
+    {
+        if (cell_size <= 0 || wire_pitch <= 0)
+            throw std::invalid_argument("HitGrid: cell size and wire pitch must be positive");
+        build(wire, drift, n);
+    }
+
+    HitGrid(const std::vector<float>& wire, const std::vector<float>& drift, float cell_size = 2.0, float wire_pitch = WIRE_PITCH)
+        : HitGrid(wire.data(), drift.data(), check_sizes(wire, drift), cell_size, wire_pitch) {}
+
+    size_t size() const { return ids_.size(); }
+    float get_cell_size() const { return cell_; }
+
+    // Hits within `radius` cm of (wire, drift), in no particular order
+    void query_radius(float wire, float drift, float radius, std::vector<int>& out) const
+    {
+        visit_radius(wire, drift, radius, [&](size_t k) { out.push_back(ids_[k]); });
+    }
+
+    int count_radius(float wire, float drift, float radius) const
+    {
+        int count = 0;
+        visit_radius(wire, drift, radius, [&](size_t) { count++; });
+        return count;
+    }
+
+    // Hits with wire in [wire_min, wire_max] and drift in [drift_min, drift_max]
+    void query_box(float wire_min, float wire_max, float drift_min, float drift_max, std::vector<int>& out) const
+    {
+        if (ids_.empty()) return;
+        float y_min = wire_min * pitch_, y_max = wire_max * pitch_;
+        int ix0, ix1, iy0, iy1;
+        if (!cell_range(drift_min, drift_max, y_min, y_max, ix0, ix1, iy0, iy1)) return;
+
+        for (int iy = iy0; iy <= iy1; ++iy) {
+            for (size_t k = start_[iy * nx_ + ix0]; k < start_[iy * nx_ + ix1 + 1]; ++k) {
+                if (xs_[k] >= drift_min && xs_[k] <= drift_max && ys_[k] >= y_min && ys_[k] <= y_max) out.push_back(ids_[k]);
+            }
+        }
+    }
+
+    // The k nearest hits, closest first; fewer if the plane has fewer hits
+    void query_nearest(float wire, float drift, int k, std::vector<int>& out) const
+    {
+        if (ids_.empty() || k <= 0) return;
+        float x = drift, y = wire * pitch_;
+        int cx = int(std::floor((x - x0_) / cell_));
+        int cy = int(std::floor((y - y0_) / cell_));
+
+        // Max-heap of the best k so far, by squared distance
+        std::priority_queue<std::pair<float, size_t>> best;
+
+        auto visit_cell = [&](int ix, int iy) {
+            if (ix < 0 || ix >= nx_) return;
+            for (size_t p = start_[iy * nx_ + ix]; p < start_[iy * nx_ + ix + 1]; ++p) {
+                float d2 = (xs_[p] - x) * (xs_[p] - x) + (ys_[p] - y) * (ys_[p] - y);
+                if (int(best.size()) < k) best.push(std::make_pair(d2, p));
+                else if (d2 < best.top().first) {
+                    best.pop();
+                    best.push(std::make_pair(d2, p));
+                }
+            }
+        };
+
+        // Rings of cells around the query's cell, starting at the first ring that reaches the grid
+        int r = std::max({ 0, -cx, cx - (nx_ - 1), -cy, cy - (ny_ - 1) });
+        for (;; ++r) {
+            for (int iy = std::max(0, cy - r); iy <= std::min(ny_ - 1, cy + r); ++iy) {
+                if (iy == cy - r || iy == cy + r) {
+                    for (int ix = std::max(0, cx - r); ix <= std::min(nx_ - 1, cx + r); ++ix) visit_cell(ix, iy);
+                }
+                else {
+                    visit_cell(cx - r, iy);
+                    if (r > 0) visit_cell(cx + r, iy);
+                }
+            }
+
+            bool covers_grid = cx - r <= 0 && cx + r >= nx_ - 1 && cy - r <= 0 && cy + r >= ny_ - 1;
+            if (covers_grid) break;
+
+            // Anything not yet visited lies outside the square of rings 0..r
+            float reach = std::min({ x - (x0_ + (cx - r) * cell_), x0_ + (cx + r + 1) * cell_ - x,
+                                     y - (y0_ + (cy - r) * cell_), y0_ + (cy + r + 1) * cell_ - y });
+            if (int(best.size()) == k && best.top().first <= reach * reach) break;
+        }
+
+        size_t first = out.size();
+        out.resize(first + best.size());
+        for (size_t i = out.size(); i-- > first; best.pop()) out[i] = ids_[best.top().second];
+    }
+
+    // Batched forms, one query point per element of (wires, drifts)
+    std::vector<int> count_radius(const std::vector<float>& wires, const std::vector<float>& drifts, float radius) const
+    {
+        check_sizes(wires, drifts);
+        std::vector<int> counts(wires.size());
+        for (size_t q = 0; q < wires.size(); ++q) counts[q] = count_radius(wires[q], drifts[q], radius);
+        return counts;
+    }
+
+    match_kernels::JaggedBatch<int> query_radius(const std::vector<float>& wires, const std::vector<float>& drifts, float radius) const
+    {
+        check_sizes(wires, drifts);
+        match_kernels::JaggedBatch<int> result;
+        result.offsets.reserve(wires.size() + 1);
+        for (size_t q = 0; q < wires.size(); ++q) {
+            query_radius(wires[q], drifts[q], radius, result.values);
+            result.offsets.push_back(int(result.values.size()));
+        }
+        return result;
+    }
+
+    match_kernels::JaggedBatch<int> query_nearest(const std::vector<float>& wires, const std::vector<float>& drifts, int k) const
+    {
+        check_sizes(wires, drifts);
+        match_kernels::JaggedBatch<int> result;
+        result.offsets.reserve(wires.size() + 1);
+        for (size_t q = 0; q < wires.size(); ++q) {
+            query_nearest(wires[q], drifts[q], k, result.values);
+            result.offsets.push_back(int(result.values.size()));
+        }
+        return result;
+    }
+
+private:
+    float pitch_;
+    float cell_;
+    int nx_, ny_;
+    float x0_, y0_;
+    std::vector<size_t> start_;   // nx_ * ny_ + 1 cell offsets into the sorted points
+    std::vector<float> xs_, ys_;  // drift and scaled wire, in cell order
+    std::vector<int> ids_;        // input index of each sorted point
+
+    static size_t check_sizes(const std::vector<float>& wire, const std::vector<float>& drift)
+    {
+        if (wire.size() != drift.size())
+            throw std::invalid_argument("HitGrid: wire and drift arrays differ in length");
+        return wire.size();
+    }
+
+    void build(const float* wire, const float* drift, size_t n)
+    {
+        start_.assign(2, 0);
+        if (n == 0) return;
+
+        float x_min = drift[0], x_max = drift[0], y_min = wire[0] * pitch_, y_max = y_min;
+        for (size_t i = 1; i < n; ++i) {
+            x_min = std::min(x_min, drift[i]);
+            x_max = std::max(x_max, drift[i]);
+            y_min = std::min(y_min, wire[i] * pitch_);
+            y_max = std::max(y_max, wire[i] * pitch_);
+        }
+
+        // Keep the cell count within a few times the hit count for sparse events
+        double max_cells = 4.0 * n + 16;
+        while (double(int((x_max - x_min) / cell_) + 1) * (int((y_max - y_min) / cell_) + 1) > max_cells) cell_ *= 2;
+
+        x0_ = x_min;
+        y0_ = y_min;
+        nx_ = int((x_max - x_min) / cell_) + 1;
+        ny_ = int((y_max - y_min) / cell_) + 1;
+
+        std::vector<int> cell_of(n);
+        start_.assign(size_t(nx_) * ny_ + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            int ix = std::min(nx_ - 1, int((drift[i] - x0_) / cell_));
+            int iy = std::min(ny_ - 1, int((wire[i] * pitch_ - y0_) / cell_));
+            cell_of[i] = iy * nx_ + ix;
+            start_[cell_of[i] + 1]++;
+        }
+        for (size_t c = 1; c < start_.size(); ++c) start_[c] += start_[c - 1];
+
+        xs_.resize(n);
+        ys_.resize(n);
+        ids_.resize(n);
+        std::vector<size_t> fill(start_.begin(), start_.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            size_t k = fill[cell_of[i]]++;
+            xs_[k] = drift[i];
+            ys_[k] = wire[i] * pitch_;
+            ids_[k] = int(i);
+        }
+    }
+
+    // Clipped cell range covering [x_lo, x_hi] x [y_lo, y_hi]; false if it misses the grid
+    bool cell_range(float x_lo, float x_hi, float y_lo, float y_hi, int& ix0, int& ix1, int& iy0, int& iy1) const
+    {
+        float fx0 = std::floor((x_lo - x0_) / cell_), fx1 = std::floor((x_hi - x0_) / cell_);
+        float fy0 = std::floor((y_lo - y0_) / cell_), fy1 = std::floor((y_hi - y0_) / cell_);
+        if (fx1 < 0 || fy1 < 0 || fx0 > nx_ - 1 || fy0 > ny_ - 1 || fx0 > fx1 || fy0 > fy1) return false;
+
+        ix0 = std::max(0, int(fx0));
+        ix1 = std::min(nx_ - 1, int(fx1));
+        iy0 = std::max(0, int(fy0));
+        iy1 = std::min(ny_ - 1, int(fy1));
+        return true;
+    }
+
+    template <typename F> void visit_radius(float wire, float drift, float radius, F visit) const
+    {
+        if (ids_.empty() || radius < 0) return;
+        float x = drift, y = wire * pitch_;
+        int ix0, ix1, iy0, iy1;
+        if (!cell_range(x - radius, x + radius, y - radius, y + radius, ix0, ix1, iy0, iy1)) return;
+
+        float r2 = radius * radius;
+        for (int iy = iy0; iy <= iy1; ++iy) {
+            // Cells of one row are contiguous in the sorted points
+            for (size_t k = start_[iy * nx_ + ix0]; k < start_[iy * nx_ + ix1 + 1]; ++k) {
+                float dx = xs_[k] - x, dy = ys_[k] - y;
+                if (dx * dx + dy * dy <= r2) visit(k);
+            }
+        }
+    }
+};
+
+#endif // HITGRID_H
@@ -0,0 +1,277 @@
+#ifndef HITIMAGEEXPORTER_H
+#define HITIMAGEEXPORTER_H
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "AnalysisEvent.h"
+#include "DisplayAssembler.h"
+
+// Fixed-size wire x drift images of every plane, cropped around the neutrino
+// vertex, written as .npy shards for image-based training.
+//
+// Per event the image array is uint8 [plane][channel][wire][drift] with
+// channels kRecoHitCount, kTrueHitCount and kTrueOwner (a DisplayAssembler
+// owner class); the hit branches carry no charge, so hit density stands in
+// for it. Counts saturate at 255.
+// Labels are int64 [entry, run, subrun, event, category, topology].
+//
+// Labels are taken from AnalysisEvent in the caller's loop; write() then
+// forks workers over contiguous entry ranges, each reading hits through its
+// own DisplayAssembler and streaming its own shards. <prefix>_index.csv maps
+// every row of every shard back to its entry.
+struct HitImageConfig
+{
+    int width = 128;                    // drift pixels
+    int height = 128;                   // wire pixels
+    float drift_per_pixel = 0.3;        // cm, about one wire pitch
+    float wires_per_pixel = 1.0;
+    bool centre_on_reco_vertex = true;  // false crops around the true vertex
+    int shard_size = 1024;              // events per shard
+};
+
+class HitImageExporter
+{
+public:
+    enum Channel { kRecoHitCount, kTrueHitCount, kTrueOwner, kNumChannels };
+    enum Label { kLabelEntry, kLabelRun, kLabelSubrun, kLabelEvent, kLabelCategory, kLabelTopology, kNumLabels };
+
+    static const int kNumPlanes = 3;
+
+    HitImageExporter(const std::string& input_name, const HitImageConfig& config = HitImageConfig())
+        : input_name_(input_name), config_(config)
+    {
+        if (config_.width <= 0 || config_.height <= 0 || config_.shard_size <= 0)
+            throw std::invalid_argument("HitImageExporter: image and shard sizes must be positive");
+        if (config_.drift_per_pixel <= 0 || config_.wires_per_pixel <= 0)
+            throw std::invalid_argument("HitImageExporter: pixel scales must be positive");
+    }
+
+    void add(int entry, const AnalysisEvent& e)
+    {
+        labels_.push_back({ entry, e.run, e.subrun, e.event, int64_t(e.category), int64_t(e.topology) });
+    }
+
+    size_t size() const { return labels_.size(); }
+
+    size_t get_image_bytes() const { return size_t(kNumPlanes) * kNumChannels * config_.width * config_.height; }
+
+    void write(const std::string& output_prefix, int n_workers = 4) const
+    {
+        if (labels_.empty()) return;
+
+        n_workers = std::max(1, std::min(n_workers, int(labels_.size())));
+        size_t chunk = (labels_.size() + n_workers - 1) / n_workers;
+
+        std::vector<pid_t> workers;
+        for (int w = 0; w < n_workers; ++w) {
+            size_t first = w * chunk;
+            size_t last = std::min(labels_.size(), first + chunk);
+            if (first >= last) break;
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                wait_for(workers);
+                throw std::runtime_error("HitImageExporter: cannot fork writer");
+            }
+            if (pid == 0) {
+                int status = 0;
+                try {
+                    DisplayAssembler assembler(input_name_);
+                    write_range(assembler, output_prefix, w, first, last);
+                }
+                catch (const std::exception& ex) {
+                    std::cerr << "HitImageExporter: writer " << w << ": " << ex.what() << std::endl;
+                    status = 1;
+                }
+                _exit(status);
+            }
+            workers.push_back(pid);
+        }
+
+        int failed = wait_for(workers);
+        if (failed > 0)
+            throw std::runtime_error("HitImageExporter: " + std::to_string(failed) + " writers failed");
+
+        write_index(output_prefix, n_workers, chunk);
+        std::cout << "HitImageExporter: wrote " << labels_.size() << " events to " << output_prefix << "_*.npy" << std::endl;
+    }
+
+    // Render one event into `image` (get_image_bytes() long); the assembler
+    // must already hold the entry
+    void fill_image(const DisplayAssembler& assembler, uint8_t* image) const
+    {
+        std::fill(image, image + get_image_bytes(), 0);
+        const size_t channel_size = size_t(config_.width) * config_.height;
+
+        for (int p = 0; p < kNumPlanes; ++p) {
+            DisplayAssembler::PlaneHits plane = assembler.get_plane(p);
+            uint8_t* plane_image = image + size_t(p) * kNumChannels * channel_size;
+
+            float centre_drift = config_.centre_on_reco_vertex ? plane.reco_vertex_drift : plane.true_vertex_drift;
+            float centre_wire = config_.centre_on_reco_vertex ? plane.reco_vertex_wire : plane.true_vertex_wire;
+            auto pixel = [&](float wire, float drift) -> long {
+                long col = long(std::floor((drift - centre_drift) / config_.drift_per_pixel)) + config_.width / 2;
+                long row = long(std::floor((wire - centre_wire) / config_.wires_per_pixel)) + config_.height / 2;
+                if (col < 0 || row < 0 || col >= config_.width || row >= config_.height) return -1;
+                return row * config_.width + col;
+            };
+
+            uint8_t* reco_count = plane_image + kRecoHitCount * channel_size;
+            for (size_t k = 0; k < plane.reco_wire->size(); ++k) {
+                const std::vector<float>& wires = plane.reco_wire->at(k);
+                const std::vector<float>& drifts = plane.reco_drift->at(k);
+                for (size_t hit = 0; hit < wires.size(); ++hit) {
+                    long px = pixel(wires[hit], drifts[hit]);
+                    if (px >= 0 && reco_count[px] < 255) reco_count[px]++;
+                }
+            }
+
+            uint8_t* true_count = plane_image + kTrueHitCount * channel_size;
+            uint8_t* owner = plane_image + kTrueOwner * channel_size;
+            for (size_t i = 0; i < plane.wire->size(); ++i) {
+                long px = pixel(plane.wire->at(i), plane.drift->at(i));
+                if (px < 0) continue;
+                if (true_count[px] < 255) true_count[px]++;
+                owner[px] = uint8_t(DisplayAssembler::get_owner_class(int(plane.owner->at(i))));
+            }
+        }
+    }
+
+private:
+    std::string input_name_;
+    HitImageConfig config_;
+    std::vector<std::array<int64_t, kNumLabels>> labels_;
+
+    static std::string shard_name(const std::string& output_prefix, const std::string& kind, int worker, size_t shard)
+    {
+        return output_prefix + "_" + kind + "_w" + std::to_string(worker) + "_" + std::to_string(shard) + ".npy";
+    }
+
+    void write_range(const DisplayAssembler& assembler, const std::string& output_prefix, int worker, size_t first, size_t last) const
+    {
+        std::vector<uint8_t> image(get_image_bytes());
+        for (size_t shard_first = first, shard = 0; shard_first < last; shard_first += config_.shard_size, ++shard) {
+            size_t shard_last = std::min(last, shard_first + size_t(config_.shard_size));
+            size_t n = shard_last - shard_first;
+
+            NpyWriter images(shard_name(output_prefix, "images", worker, shard), "|u1",
+                             { n, size_t(kNumPlanes), size_t(kNumChannels), size_t(config_.height), size_t(config_.width) });
+            NpyWriter labels(shard_name(output_prefix, "labels", worker, shard), "<i8", { n, size_t(kNumLabels) });
+
+            for (size_t k = shard_first; k < shard_last; ++k) {
+                assembler.load_event(int(labels_[k][kLabelEntry]));
+                fill_image(assembler, image.data());
+                images.append(image.data(), image.size());
+                labels.append(labels_[k].data(), labels_[k].size() * sizeof(int64_t));
+            }
+            images.close();
+            labels.close();
+        }
+    }
+
+    // Written by the parent from the same split the workers used
+    void write_index(const std::string& output_prefix, int n_workers, size_t chunk) const
+    {
+        std::string path = output_prefix + "_index.csv";
+        std::FILE* out = std::fopen(path.c_str(), "w");
+        if (!out)
+            throw std::runtime_error("HitImageExporter: cannot write '" + path + "'");
+
+        std::fprintf(out, "shard,row,entry,run,subrun,event,category,topology\n");
+        for (size_t k = 0; k < labels_.size(); ++k) {
+            int worker = int(k / chunk);
+            size_t offset = k - worker * chunk;
+            std::string shard = shard_name(output_prefix, "images", worker, offset / config_.shard_size);
+            const std::array<int64_t, kNumLabels>& l = labels_[k];
+            std::fprintf(out, "%s,%zu,%lld,%lld,%lld,%lld,%lld,%lld\n", shard.c_str(), offset % config_.shard_size,
+                         (long long)l[kLabelEntry], (long long)l[kLabelRun], (long long)l[kLabelSubrun],
+                         (long long)l[kLabelEvent], (long long)l[kLabelCategory], (long long)l[kLabelTopology]);
+        }
+
+        if (std::fclose(out) != 0)
+            throw std::runtime_error("HitImageExporter: error writing '" + path + "'");
+    }
+
+    static int wait_for(const std::vector<pid_t>& workers)
+    {
+        int failed = 0;
+        for (pid_t pid : workers) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+        }
+        return failed;
+    }
+
+    // C-order .npy (format 1.0) with the shape known up front; rows stream out
+    class NpyWriter
+    {
+    public:
+        NpyWriter(const std::string& path, const std::string& descr, const std::vector<size_t>& shape)
+            : path_(path), out_(std::fopen(path.c_str(), "wb"))
+        {
+            if (!out_)
+                throw std::runtime_error("HitImageExporter: cannot write '" + path + "'");
+
+            std::string dims;
+            for (size_t d : shape) dims += std::to_string(d) + ", ";
+            if (shape.size() > 1) dims.erase(dims.size() - 2);
+            std::string header = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + dims + "), }";
+
+            // Magic, version and length take 10 bytes; pad so data starts 64-byte aligned
+            size_t total = 10 + header.size() + 1;
+            header.append((64 - total % 64) % 64, ' ');
+            header += '\n';
+
+            uint16_t length = uint16_t(header.size());
+            const char magic[8] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+            const unsigned char length_bytes[2] = { uint8_t(length), uint8_t(length >> 8) };
+            std::fwrite(magic, 1, 8, out_);
+            std::fwrite(length_bytes, 1, 2, out_);
+            std::fwrite(header.data(), 1, header.size(), out_);
+        }
+
+        NpyWriter(const NpyWriter&) = delete;
+        NpyWriter& operator=(const NpyWriter&) = delete;
+
+        // Fallback for writers abandoned by an exception; close() reports errors
+        ~NpyWriter()
+        {
+            if (out_) std::fclose(out_);
+        }
+
+        void append(const void* data, size_t bytes)
+        {
+            if (std::fwrite(data, 1, bytes, out_) != bytes)
+                throw std::runtime_error("HitImageExporter: error writing '" + path_ + "'");
+        }
+
+        // Buffered writes can fail only at the final flush, so check it
+        void close()
+        {
+            bool failed = std::ferror(out_) != 0;
+            int closed = std::fclose(out_);
+            out_ = nullptr;
+            if (closed != 0 || failed)
+                throw std::runtime_error("HitImageExporter: error writing '" + path_ + "'");
+        }
+
+    private:
+        std::string path_;
+        std::FILE* out_;
+    };
+};
+
+#endif // HITIMAGEEXPORTER_H
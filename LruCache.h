@@ -0,0 +1,115 @@
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <typeindex>
+#include <functional>
+#include <stdexcept>
+
+// Shared results of any type under a memory budget. Every entry carries
+// its size in bytes; once the total exceeds the budget the least recently
+// used entries are dropped. Entries larger than the whole budget are
+// returned to the caller but never stored.
+template <typename K> class LruCache
+{
+public:
+    LruCache(size_t budget_bytes) : budget_(budget_bytes), bytes_(0), hits_(0), misses_(0), evictions_(0) {}
+
+    // Null if the key is absent
+    template <typename T> std::shared_ptr<const T> get(const K& key)
+    {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            misses_++;
+            return nullptr;
+        }
+
+        if (it->second.type != std::type_index(typeid(T)))
+            throw std::invalid_argument("LruCache: entry holds a different type");
+
+        order_.splice(order_.begin(), order_, it->second.position);
+        hits_++;
+        return std::static_pointer_cast<const T>(it->second.value);
+    }
+
+    template <typename T> void put(const K& key, std::shared_ptr<const T> value, size_t bytes)
+    {
+        erase(key);
+        if (bytes > budget_) return;
+
+        order_.push_front(key);
+        entries_.emplace(key, Entry{value, std::type_index(typeid(T)), bytes, order_.begin()});
+        bytes_ += bytes;
+        evict();
+    }
+
+    template <typename T> std::shared_ptr<const T> get_or_compute(const K& key, std::function<std::shared_ptr<const T>()> compute,
+                                                                  std::function<size_t(const T&)> size)
+    {
+        std::shared_ptr<const T> value = get<T>(key);
+        if (value) return value;
+
+        value = compute();
+        put<T>(key, value, size(*value));
+        return value;
+    }
+
+    void erase(const K& key)
+    {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return;
+
+        bytes_ -= it->second.bytes;
+        order_.erase(it->second.position);
+        entries_.erase(it);
+    }
+
+    void clear()
+    {
+        entries_.clear();
+        order_.clear();
+        bytes_ = 0;
+    }
+
+    void set_budget(size_t budget_bytes)
+    {
+        budget_ = budget_bytes;
+        evict();
+    }
+
+    size_t get_budget() const { return budget_; }
+    size_t get_bytes() const { return bytes_; }
+    size_t get_num_entries() const { return entries_.size(); }
+    long get_hits() const { return hits_; }
+    long get_misses() const { return misses_; }
+    long get_evictions() const { return evictions_; }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const void> value;
+        std::type_index type;
+        size_t bytes;
+        typename std::list<K>::iterator position;
+    };
+
+    size_t budget_;
+    size_t bytes_;
+    long hits_, misses_, evictions_;
+
+    // Most recently used at the front
+    std::list<K> order_;
+    std::unordered_map<K, Entry> entries_;
+
+    void evict()
+    {
+        while (bytes_ > budget_ && !order_.empty()) {
+            erase(order_.back());
+            evictions_++;
+        }
+    }
+};
+
+#endif // LRUCACHE_H
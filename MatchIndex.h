@@ -0,0 +1,266 @@
+#ifndef MATCHINDEX_H
+#define MATCHINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include "TTree.h"
+
+#include "TreeUtilities.h"
+#include "Constants.h"
+#include "MatchKernels.h"
+
+struct PfpMatch
+{
+    int tid;
+    int pfp;
+    int n_hits;
+    float purity;
+    float completeness;
+};
+
+// Truth track ID -> PFP candidates for one event, built once when the event
+// is decoded. Candidates of a track are ordered by hits, then purity, then
+// completeness, so the first is the best match. For the signal muon and
+// K0S pions it also holds the first PFP passing the purity/completeness
+// match cuts and a conflict-resolved assignment to distinct PFPs.
+class MatchIndex
+{
+public:
+    enum SignalParticle { kMuon = 0, kPiPlus = 1, kPiMinus = 2, kNumSignalParticles = 3 };
+
+    // Candidates considered per particle when resolving shared PFPs
+    static constexpr int max_resolve_candidates = 4;
+
+    MatchIndex() { clear(); }
+
+    void clear()
+    {
+        matches_.clear();
+        tids_.clear();
+        offsets_.assign(1, 0);
+        std::fill(first_match_, first_match_ + kNumSignalParticles, BOGUS_INDEX);
+        std::fill(resolved_match_, resolved_match_ + kNumSignalParticles, BOGUS_INDEX);
+    }
+
+    void build(const std::vector<int>& backtracked_tid, const std::vector<int>& pfnhits,
+               const std::vector<float>& purity, const std::vector<float>& completeness)
+    {
+        matches_.clear();
+        tids_.clear();
+        offsets_.assign(1, 0);
+
+        size_t n = std::min(std::min(backtracked_tid.size(), pfnhits.size()), std::min(purity.size(), completeness.size()));
+        for (size_t j = 0; j < n; ++j) {
+            matches_.push_back({backtracked_tid[j], int(j), pfnhits[j], purity[j], completeness[j]});
+        }
+
+        std::sort(matches_.begin(), matches_.end(), [](const PfpMatch& a, const PfpMatch& b) {
+            if (a.tid != b.tid) return a.tid < b.tid;
+            if (a.n_hits != b.n_hits) return a.n_hits > b.n_hits;
+            if (a.purity != b.purity) return a.purity > b.purity;
+            return a.completeness > b.completeness;
+        });
+
+        index_tids();
+    }
+
+    // Per-PFP purity/completeness with respect to the muon, pi+ and pi-
+    void build_signal(const std::vector<float>* purity[kNumSignalParticles], const std::vector<float>* completeness[kNumSignalParticles])
+    {
+        std::vector<int> candidates[kNumSignalParticles];
+
+        for (int p = 0; p < kNumSignalParticles; ++p) {
+            const std::vector<float>& pur = *purity[p];
+            const std::vector<float>& comp = *completeness[p];
+            first_match_[p] = match_kernels::first_match(pur, comp);
+            if (first_match_[p] == BOGUS_INDEX) continue;
+
+            size_t n = std::min(pur.size(), comp.size());
+            for (size_t j = first_match_[p]; j < n; ++j) {
+                if (pur[j] >= PFP_MATCH_PURITY_CUT && comp[j] >= PFP_MATCH_COMPLETENESS_CUT) candidates[p].push_back(int(j));
+            }
+
+            std::stable_sort(candidates[p].begin(), candidates[p].end(),
+                             [&comp](int a, int b) { return comp[a] > comp[b]; });
+            if (candidates[p].size() > size_t(max_resolve_candidates)) candidates[p].resize(max_resolve_candidates);
+        }
+
+        resolve(candidates, completeness);
+    }
+
+    int get_num_candidates(int tid) const
+    {
+        size_t t = find_tid(tid);
+        return (t == tids_.size()) ? 0 : offsets_[t + 1] - offsets_[t];
+    }
+
+    // Rank 0 is the best match; nullptr if the track has no such candidate
+    const PfpMatch* get_candidate(int tid, int rank) const
+    {
+        size_t t = find_tid(tid);
+        if (t == tids_.size() || rank < 0 || rank >= offsets_[t + 1] - offsets_[t]) return nullptr;
+        return &matches_[offsets_[t] + rank];
+    }
+
+    const PfpMatch* get_best_match(int tid) const { return get_candidate(tid, 0); }
+
+    // First PFP passing the match cuts, or BOGUS_INDEX
+    int get_first_match(SignalParticle p) const { return first_match_[p]; }
+
+    // Assignment to distinct PFPs, or BOGUS_INDEX when unassigned
+    int get_resolved_match(SignalParticle p) const { return resolved_match_[p]; }
+
+    // All three signal particles have a first match and no two share a PFP
+    bool has_distinct_first_matches() const
+    {
+        return first_match_[kMuon] != BOGUS_INDEX && first_match_[kPiPlus] != BOGUS_INDEX && first_match_[kPiMinus] != BOGUS_INDEX &&
+               first_match_[kMuon] != first_match_[kPiPlus] &&
+               first_match_[kMuon] != first_match_[kPiMinus] &&
+               first_match_[kPiPlus] != first_match_[kPiMinus];
+    }
+
+    bool has_resolved_matches() const
+    {
+        return resolved_match_[kMuon] != BOGUS_INDEX && resolved_match_[kPiPlus] != BOGUS_INDEX && resolved_match_[kPiMinus] != BOGUS_INDEX;
+    }
+
+    const std::vector<PfpMatch>& get_matches() const { return matches_; }
+
+    // Flat per-event record of the index for caching it in a TTree
+    class CacheRecord
+    {
+    public:
+        void set_output_branches(TTree& tree)
+        {
+            tree_utils::set_object_output_branch_address(tree, "match_tid", tid_, true);
+            tree_utils::set_object_output_branch_address(tree, "match_pfp", pfp_, true);
+            tree_utils::set_object_output_branch_address(tree, "match_n_hits", n_hits_, true);
+            tree_utils::set_object_output_branch_address(tree, "match_purity", purity_, true);
+            tree_utils::set_object_output_branch_address(tree, "match_completeness", completeness_, true);
+            tree_utils::set_output_branch_address(tree, "first_match", first_match_, true, "first_match[3]/I");
+            tree_utils::set_output_branch_address(tree, "resolved_match", resolved_match_, true, "resolved_match[3]/I");
+        }
+
+        void set_input_branches(TTree& tree)
+        {
+            tree_utils::set_object_input_branch_address(tree, "match_tid", tid_);
+            tree_utils::set_object_input_branch_address(tree, "match_pfp", pfp_);
+            tree_utils::set_object_input_branch_address(tree, "match_n_hits", n_hits_);
+            tree_utils::set_object_input_branch_address(tree, "match_purity", purity_);
+            tree_utils::set_object_input_branch_address(tree, "match_completeness", completeness_);
+            tree.SetBranchAddress("first_match", first_match_);
+            tree.SetBranchAddress("resolved_match", resolved_match_);
+        }
+
+        void store(const MatchIndex& index)
+        {
+            tid_->clear();
+            pfp_->clear();
+            n_hits_->clear();
+            purity_->clear();
+            completeness_->clear();
+            for (const PfpMatch& m : index.matches_) {
+                tid_->push_back(m.tid);
+                pfp_->push_back(m.pfp);
+                n_hits_->push_back(m.n_hits);
+                purity_->push_back(m.purity);
+                completeness_->push_back(m.completeness);
+            }
+            std::copy(index.first_match_, index.first_match_ + kNumSignalParticles, first_match_);
+            std::copy(index.resolved_match_, index.resolved_match_ + kNumSignalParticles, resolved_match_);
+        }
+
+        // The stored matches are already in index order
+        void restore(MatchIndex& index) const
+        {
+            index.matches_.clear();
+            for (size_t j = 0; j < tid_->size(); ++j) {
+                index.matches_.push_back({tid_->at(j), pfp_->at(j), n_hits_->at(j), purity_->at(j), completeness_->at(j)});
+            }
+            index.index_tids();
+            std::copy(first_match_, first_match_ + kNumSignalParticles, index.first_match_);
+            std::copy(resolved_match_, resolved_match_ + kNumSignalParticles, index.resolved_match_);
+        }
+
+    private:
+        tree_utils::ManagedPointer<std::vector<int>> tid_;
+        tree_utils::ManagedPointer<std::vector<int>> pfp_;
+        tree_utils::ManagedPointer<std::vector<int>> n_hits_;
+        tree_utils::ManagedPointer<std::vector<float>> purity_;
+        tree_utils::ManagedPointer<std::vector<float>> completeness_;
+        int first_match_[kNumSignalParticles];
+        int resolved_match_[kNumSignalParticles];
+    };
+
+private:
+    std::vector<PfpMatch> matches_;
+    std::vector<int> tids_;
+    std::vector<int> offsets_;
+
+    int first_match_[kNumSignalParticles];
+    int resolved_match_[kNumSignalParticles];
+
+    void index_tids()
+    {
+        tids_.clear();
+        offsets_.assign(1, 0);
+        for (size_t j = 0; j < matches_.size(); ++j) {
+            if (j == 0 || matches_[j].tid != matches_[j - 1].tid) {
+                if (j > 0) offsets_.push_back(int(j));
+                tids_.push_back(matches_[j].tid);
+            }
+        }
+        if (!matches_.empty()) offsets_.push_back(int(matches_.size()));
+    }
+
+    size_t find_tid(int tid) const
+    {
+        auto it = std::lower_bound(tids_.begin(), tids_.end(), tid);
+        return (it != tids_.end() && *it == tid) ? size_t(it - tids_.begin()) : tids_.size();
+    }
+
+    // Pick distinct PFPs maximising the number of assigned particles, then the
+    // summed completeness, over each particle's best few candidates
+    void resolve(const std::vector<int> candidates[kNumSignalParticles], const std::vector<float>* completeness[kNumSignalParticles])
+    {
+        int best_assigned = -1;
+        double best_score = -1.0;
+        std::fill(resolved_match_, resolved_match_ + kNumSignalParticles, BOGUS_INDEX);
+
+        // Index n_candidates stands for leaving the particle unassigned
+        int n0 = int(candidates[kMuon].size()), n1 = int(candidates[kPiPlus].size()), n2 = int(candidates[kPiMinus].size());
+        for (int i0 = 0; i0 <= n0; ++i0) {
+            for (int i1 = 0; i1 <= n1; ++i1) {
+                for (int i2 = 0; i2 <= n2; ++i2) {
+                    int pick[kNumSignalParticles] = {
+                        (i0 < n0) ? candidates[kMuon][i0] : BOGUS_INDEX,
+                        (i1 < n1) ? candidates[kPiPlus][i1] : BOGUS_INDEX,
+                        (i2 < n2) ? candidates[kPiMinus][i2] : BOGUS_INDEX
+                    };
+
+                    int assigned = 0;
+                    double score = 0.0;
+                    bool distinct = true;
+                    for (int p = 0; p < kNumSignalParticles; ++p) {
+                        if (pick[p] == BOGUS_INDEX) continue;
+                        for (int q = 0; q < p; ++q) {
+                            if (pick[q] == pick[p]) distinct = false;
+                        }
+                        assigned++;
+                        score += completeness[p]->at(pick[p]);
+                    }
+
+                    if (distinct && (assigned > best_assigned || (assigned == best_assigned && score > best_score))) {
+                        best_assigned = assigned;
+                        best_score = score;
+                        std::copy(pick, pick + kNumSignalParticles, resolved_match_);
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif // MATCHINDEX_H
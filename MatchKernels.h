@@ -0,0 +1,301 @@
+#ifndef MATCHKERNELS_H
+#define MATCHKERNELS_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "Constants.h"
+
+// Reductions over the per-PFP arrays of one event (pfp_*_purity/completeness,
+// pfnhits, backtracked_tid), using 8-wide AVX lanes where the compiler
+// targets them and a scalar loop otherwise. Every kernel returns the same
+// index as the plain first-wins scan it replaces; indices are local to the
+// event and BOGUS_INDEX means no PFP qualified.
+namespace match_kernels
+{
+    // First PFP with purity >= purity_cut and completeness >= completeness_cut
+    inline int first_match(const float* purity, const float* completeness, size_t n,
+                           float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        size_t j = 0;
+#if defined(__AVX__)
+        const __m256 p_cut = _mm256_set1_ps(purity_cut);
+        const __m256 c_cut = _mm256_set1_ps(completeness_cut);
+        for (; j + 8 <= n; j += 8) {
+            __m256 pass = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(purity + j), p_cut, _CMP_GE_OQ),
+                                        _mm256_cmp_ps(_mm256_loadu_ps(completeness + j), c_cut, _CMP_GE_OQ));
+            int mask = _mm256_movemask_ps(pass);
+            if (mask) return int(j) + __builtin_ctz(mask);
+        }
+#endif
+        for (; j < n; ++j) {
+            if (purity[j] >= purity_cut && completeness[j] >= completeness_cut) return int(j);
+        }
+        return BOGUS_INDEX;
+    }
+
+    // Number of PFPs passing both cuts
+    inline int count_passing(const float* purity, const float* completeness, size_t n,
+                             float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        size_t j = 0;
+        int count = 0;
+#if defined(__AVX__)
+        const __m256 p_cut = _mm256_set1_ps(purity_cut);
+        const __m256 c_cut = _mm256_set1_ps(completeness_cut);
+        for (; j + 8 <= n; j += 8) {
+            __m256 pass = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(purity + j), p_cut, _CMP_GE_OQ),
+                                        _mm256_cmp_ps(_mm256_loadu_ps(completeness + j), c_cut, _CMP_GE_OQ));
+            count += __builtin_popcount(_mm256_movemask_ps(pass));
+        }
+#endif
+        for (; j < n; ++j) {
+            count += (purity[j] >= purity_cut && completeness[j] >= completeness_cut);
+        }
+        return count;
+    }
+
+    // Number of values strictly above the threshold, e.g. pfnhits > cut
+    inline int count_above(const int* values, size_t n, int threshold)
+    {
+        size_t j = 0;
+        int count = 0;
+#if defined(__AVX2__)
+        const __m256i t = _mm256_set1_epi32(threshold);
+        for (; j + 8 <= n; j += 8) {
+            __m256i above = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + j)), t);
+            count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(above)));
+        }
+#endif
+        for (; j < n; ++j) {
+            count += (values[j] > threshold);
+        }
+        return count;
+    }
+
+    // PFP with the largest key (e.g. pfnhits) among those whose tag equals
+    // tag_value (e.g. backtracked_tid == mc_muon_tid); ties keep the first
+    inline int argmax_by_key(const int* key, const int* tag, size_t n, int tag_value)
+    {
+        size_t j = 0;
+        int best = BOGUS_INDEX;
+        int best_key = std::numeric_limits<int>::min();
+#if defined(__AVX2__)
+        if (n >= 8) {
+            const __m256i want = _mm256_set1_epi32(tag_value);
+            const __m256i step = _mm256_set1_epi32(8);
+            __m256i lane_key = _mm256_set1_epi32(std::numeric_limits<int>::min());
+            __m256i lane_index = _mm256_set1_epi32(-1);
+            __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            for (; j + 8 <= n; j += 8) {
+                __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + j));
+                __m256i match = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tag + j)), want);
+                __m256i better = _mm256_and_si256(match, _mm256_cmpgt_epi32(k, lane_key));
+                lane_key = _mm256_blendv_epi8(lane_key, k, better);
+                lane_index = _mm256_blendv_epi8(lane_index, index, better);
+                index = _mm256_add_epi32(index, step);
+            }
+
+            // Each lane kept its first maximum; across lanes prefer the lowest index
+            alignas(32) int keys[8], indices[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(keys), lane_key);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(indices), lane_index);
+            for (int l = 0; l < 8; ++l) {
+                if (indices[l] < 0) continue;
+                if (best == BOGUS_INDEX || keys[l] > best_key || (keys[l] == best_key && indices[l] < best)) {
+                    best_key = keys[l];
+                    best = indices[l];
+                }
+            }
+        }
+#endif
+        for (; j < n; ++j) {
+            if (tag[j] == tag_value && (best == BOGUS_INDEX || key[j] > best_key)) {
+                best_key = key[j];
+                best = int(j);
+            }
+        }
+        return best;
+    }
+
+    // PFP furthest from the origin in (x, y), e.g. (purity, completeness);
+    // only distances above zero count, and ties keep the first. Under AVX the
+    // tail is a masked load through the same vector expression, so every PFP's
+    // distance is rounded alike even if the compiler fuses the multiply-add;
+    // AVX and scalar builds can still differ in the last bit when it does.
+    inline int max_paired_distance(const float* x, const float* y, size_t n)
+    {
+        size_t j = 0;
+        int best = BOGUS_INDEX;
+        float best_dist = 0.f;
+#if defined(__AVX__)
+        if (n > 0) {
+            const __m256 step = _mm256_set1_ps(8.f);
+            const __m256 lane = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+            __m256 lane_dist = _mm256_setzero_ps();
+            __m256 lane_index = _mm256_set1_ps(-1.f);
+            __m256 index = lane;
+            for (; j < n; j += 8) {
+                __m256 vx, vy;
+                if (j + 8 <= n) {
+                    vx = _mm256_loadu_ps(x + j);
+                    vy = _mm256_loadu_ps(y + j);
+                }
+                else {
+                    // Lanes past the end load zero, which never beats lane_dist
+                    __m256i mask = _mm256_castps_si256(_mm256_cmp_ps(lane, _mm256_set1_ps(float(n - j)), _CMP_LT_OQ));
+                    vx = _mm256_maskload_ps(x + j, mask);
+                    vy = _mm256_maskload_ps(y + j, mask);
+                }
+                __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+                __m256 better = _mm256_cmp_ps(d, lane_dist, _CMP_GT_OQ);
+                lane_dist = _mm256_blendv_ps(lane_dist, d, better);
+                lane_index = _mm256_blendv_ps(lane_index, index, better);
+                index = _mm256_add_ps(index, step);
+            }
+
+            // Indices are exact in float up to 2^24 PFPs
+            alignas(32) float dists[8], indices[8];
+            _mm256_store_ps(dists, lane_dist);
+            _mm256_store_ps(indices, lane_index);
+            for (int l = 0; l < 8; ++l) {
+                if (indices[l] < 0) continue;
+                if (dists[l] > best_dist || (dists[l] == best_dist && int(indices[l]) < best)) {
+                    best_dist = dists[l];
+                    best = int(indices[l]);
+                }
+            }
+        }
+#endif
+        for (; j < n; ++j) {
+            float d = std::sqrt(x[j] * x[j] + y[j] * y[j]);
+            if (d > best_dist) {
+                best_dist = d;
+                best = int(j);
+            }
+        }
+        return best;
+    }
+
+    inline int first_match(const std::vector<float>& purity, const std::vector<float>& completeness,
+                           float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        return first_match(purity.data(), completeness.data(), std::min(purity.size(), completeness.size()), purity_cut, completeness_cut);
+    }
+
+    inline int count_passing(const std::vector<float>& purity, const std::vector<float>& completeness,
+                             float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        return count_passing(purity.data(), completeness.data(), std::min(purity.size(), completeness.size()), purity_cut, completeness_cut);
+    }
+
+    inline int count_above(const std::vector<int>& values, int threshold)
+    {
+        return count_above(values.data(), values.size(), threshold);
+    }
+
+    inline int argmax_by_key(const std::vector<int>& key, const std::vector<int>& tag, int tag_value)
+    {
+        return argmax_by_key(key.data(), tag.data(), std::min(key.size(), tag.size()), tag_value);
+    }
+
+    inline int max_paired_distance(const std::vector<float>& x, const std::vector<float>& y)
+    {
+        return max_paired_distance(x.data(), y.data(), std::min(x.size(), y.size()));
+    }
+
+    // Jagged arrays of many events concatenated, with event e occupying
+    // [offsets[e], offsets[e + 1]) of the flat values
+    template <typename T> struct JaggedBatch
+    {
+        std::vector<T> values;
+        std::vector<int> offsets = {0};
+
+        void append(const std::vector<T>& event_values)
+        {
+            values.insert(values.end(), event_values.begin(), event_values.end());
+            offsets.push_back(int(values.size()));
+        }
+
+        void clear()
+        {
+            values.clear();
+            offsets.assign(1, 0);
+        }
+
+        size_t get_num_events() const { return offsets.size() - 1; }
+        const T* event_data(size_t e) const { return values.data() + offsets[e]; }
+        size_t event_size(size_t e) const { return size_t(offsets[e + 1] - offsets[e]); }
+    };
+
+    template <typename T, typename U> void check_batches(const JaggedBatch<T>& a, const JaggedBatch<U>& b)
+    {
+        if (a.offsets != b.offsets)
+            throw std::invalid_argument("match_kernels: batches have different event offsets");
+    }
+
+    // Batch forms: one result per event, indices local to each event
+    inline std::vector<int> first_match(const JaggedBatch<float>& purity, const JaggedBatch<float>& completeness,
+                                        float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        check_batches(purity, completeness);
+        std::vector<int> result(purity.get_num_events());
+        for (size_t e = 0; e < result.size(); ++e) {
+            result[e] = first_match(purity.event_data(e), completeness.event_data(e), purity.event_size(e), purity_cut, completeness_cut);
+        }
+        return result;
+    }
+
+    inline std::vector<int> count_passing(const JaggedBatch<float>& purity, const JaggedBatch<float>& completeness,
+                                          float purity_cut = PFP_MATCH_PURITY_CUT, float completeness_cut = PFP_MATCH_COMPLETENESS_CUT)
+    {
+        check_batches(purity, completeness);
+        std::vector<int> result(purity.get_num_events());
+        for (size_t e = 0; e < result.size(); ++e) {
+            result[e] = count_passing(purity.event_data(e), completeness.event_data(e), purity.event_size(e), purity_cut, completeness_cut);
+        }
+        return result;
+    }
+
+    inline std::vector<int> count_above(const JaggedBatch<int>& values, int threshold)
+    {
+        std::vector<int> result(values.get_num_events());
+        for (size_t e = 0; e < result.size(); ++e) {
+            result[e] = count_above(values.event_data(e), values.event_size(e), threshold);
+        }
+        return result;
+    }
+
+    // One tag value per event, e.g. the event's mc_muon_tid
+    inline std::vector<int> argmax_by_key(const JaggedBatch<int>& key, const JaggedBatch<int>& tag, const std::vector<int>& tag_values)
+    {
+        check_batches(key, tag);
+        if (tag_values.size() != key.get_num_events())
+            throw std::invalid_argument("match_kernels: expected one tag value per event");
+
+        std::vector<int> result(key.get_num_events());
+        for (size_t e = 0; e < result.size(); ++e) {
+            result[e] = argmax_by_key(key.event_data(e), tag.event_data(e), key.event_size(e), tag_values[e]);
+        }
+        return result;
+    }
+
+    inline std::vector<int> max_paired_distance(const JaggedBatch<float>& x, const JaggedBatch<float>& y)
+    {
+        check_batches(x, y);
+        std::vector<int> result(x.get_num_events());
+        for (size_t e = 0; e < result.size(); ++e) {
+            result[e] = max_paired_distance(x.event_data(e), y.event_data(e), x.event_size(e));
+        }
+        return result;
+    }
+}
+
+#endif // MATCHKERNELS_H
@@ -0,0 +1,243 @@
+#ifndef OCCUPANCYMAP_H
+#define OCCUPANCYMAP_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "TFile.h"
+#include "TH2D.h"
+#include "TROOT.h"
+
+#include "HistogramAccumulator.h"
+#include "DisplayAssembler.h"
+
+// Hit counts on a uniform wire x drift grid for one plane. Counts are 32-bit
+// integers rather than Histogram2D's weight sums, so a full-resolution map
+// of every plane and owner class stays small enough to keep one per thread.
+// Hits outside the grid are counted but not binned.
+class OccupancyMap
+{
+public:
+    OccupancyMap(int n_wire_bins, double wire_min, double wire_max, int n_drift_bins, double drift_min, double drift_max)
+        : n_wire_bins_(n_wire_bins), n_drift_bins_(n_drift_bins), wire_min_(wire_min), wire_max_(wire_max),
+          drift_min_(drift_min), drift_max_(drift_max), counts_(size_t(n_wire_bins) * n_drift_bins, 0), entries_(0), outside_(0)
+    {
+        if (n_wire_bins <= 0 || n_drift_bins <= 0 || !(wire_max > wire_min) || !(drift_max > drift_min))
+            throw std::invalid_argument("OccupancyMap: invalid binning");
+
+        wire_scale_ = n_wire_bins / (wire_max - wire_min);
+        drift_scale_ = n_drift_bins / (drift_max - drift_min);
+    }
+
+    void fill(float wire, float drift)
+    {
+        entries_++;
+        double fw = (wire - wire_min_) * wire_scale_, fd = (drift - drift_min_) * drift_scale_;
+        if (!(fw >= 0 && fw < n_wire_bins_ && fd >= 0 && fd < n_drift_bins_)) {
+            outside_++;
+            return;
+        }
+        counts_[size_t(fw) * n_drift_bins_ + size_t(fd)]++;
+    }
+
+    void fill_n(size_t n, const float* wire, const float* drift)
+    {
+        for (size_t i = 0; i < n; ++i) fill(wire[i], drift[i]);
+    }
+
+    void merge(const OccupancyMap& other)
+    {
+        if (other.n_wire_bins_ != n_wire_bins_ || other.n_drift_bins_ != n_drift_bins_ || other.wire_min_ != wire_min_ ||
+            other.wire_max_ != wire_max_ || other.drift_min_ != drift_min_ || other.drift_max_ != drift_max_)
+            throw std::invalid_argument("OccupancyMap: cannot merge maps with different binning");
+
+        for (size_t c = 0; c < counts_.size(); ++c) counts_[c] += other.counts_[c];
+        entries_ += other.entries_;
+        outside_ += other.outside_;
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        entries_ = 0;
+        outside_ = 0;
+    }
+
+    // Bins from 0, wire-major
+    uint32_t get_count(int wire_bin, int drift_bin) const { return counts_.at(size_t(wire_bin) * n_drift_bins_ + drift_bin); }
+    long get_entries() const { return entries_; }
+    long get_outside() const { return outside_; }
+
+    // Drift on x and wire on y, as in the event displays; caller owns the result
+    TH2D* to_th2d(const std::string& name, const std::string& title) const
+    {
+        TH2D* hist = new TH2D(name.c_str(), title.c_str(), n_drift_bins_, drift_min_, drift_max_, n_wire_bins_, wire_min_, wire_max_);
+        hist->SetDirectory(nullptr);
+        for (int w = 0; w < n_wire_bins_; ++w) {
+            for (int d = 0; d < n_drift_bins_; ++d) hist->SetBinContent(d + 1, w + 1, counts_[size_t(w) * n_drift_bins_ + d]);
+        }
+        hist->SetEntries(double(entries_));
+        return hist;
+    }
+
+private:
+    int n_wire_bins_, n_drift_bins_;
+    double wire_min_, wire_max_;
+    double drift_min_, drift_max_;
+    double wire_scale_, drift_scale_;
+    std::vector<uint32_t> counts_;
+    long entries_;
+    long outside_;
+};
+
+// Occupancy of every plane accumulated over many events: true hits split by
+// DisplayAssembler owner class, and slice hits. Workers are threads, each
+// reading through its own DisplayAssembler into its own maps (a
+// ThreadLocalHistogram), merged once at the end.
+class OccupancyAccumulator
+{
+public:
+    static constexpr int kNumPlanes = 3;
+
+    // The full set of maps for one worker
+    struct PlaneMaps
+    {
+        std::vector<OccupancyMap> true_hits;  // plane-major, then owner class
+        std::vector<OccupancyMap> slice_hits; // one per plane
+
+        void merge(const PlaneMaps& other)
+        {
+            for (size_t m = 0; m < true_hits.size(); ++m) true_hits[m].merge(other.true_hits[m]);
+            for (size_t m = 0; m < slice_hits.size(); ++m) slice_hits[m].merge(other.slice_hits[m]);
+        }
+    };
+
+    // Wires per bin and drift bin width in cm; the wire axes span each plane
+    OccupancyAccumulator(const std::string& input_name, int wires_per_bin = 4, double drift_bin_width = 1.0,
+                         double drift_min = -10.0, double drift_max = 270.0)
+        : input_name_(input_name)
+    {
+        if (wires_per_bin <= 0 || drift_bin_width <= 0)
+            throw std::invalid_argument("OccupancyAccumulator: bin sizes must be positive");
+
+        int n_drift_bins = int(std::ceil((drift_max - drift_min) / drift_bin_width));
+        for (int p = 0; p < kNumPlanes; ++p) {
+            int n_wire_bins = (kNumWires[p] + wires_per_bin - 1) / wires_per_bin;
+            OccupancyMap map(n_wire_bins, 0, double(n_wire_bins) * wires_per_bin, n_drift_bins, drift_min, drift_min + n_drift_bins * drift_bin_width);
+            for (int c = 0; c < DisplayAssembler::kNumOwnerClasses; ++c) result_.true_hits.push_back(map);
+            result_.slice_hits.push_back(map);
+        }
+    }
+
+    void add(int entry) { entries_.push_back(entry); }
+    size_t size() const { return entries_.size(); }
+
+    void accumulate(int n_threads = 4)
+    {
+        if (entries_.empty()) return;
+        n_threads = std::max(1, std::min(n_threads, int(entries_.size())));
+
+        // Each worker opens the file itself
+        ROOT::EnableThreadSafety();
+
+        PlaneMaps prototype = result_;
+        for (OccupancyMap& map : prototype.true_hits) map.reset();
+        for (OccupancyMap& map : prototype.slice_hits) map.reset();
+        ThreadLocalHistogram<PlaneMaps> maps(prototype, n_threads);
+
+        size_t chunk = (entries_.size() + n_threads - 1) / n_threads;
+        std::vector<std::thread> workers;
+        std::vector<std::string> errors(n_threads);
+        for (int t = 0; t < n_threads; ++t) {
+            size_t first = t * chunk, last = std::min(entries_.size(), first + chunk);
+            workers.emplace_back([&, t, first, last]() {
+                try {
+                    DisplayAssembler assembler(input_name_);
+                    for (size_t k = first; k < last; ++k) {
+                        assembler.load_event(entries_[k]);
+                        fill_event(assembler, maps.local(t));
+                    }
+                }
+                catch (const std::exception& ex) {
+                    errors[t] = ex.what();
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        for (const std::string& error : errors) {
+            if (!error.empty()) throw std::runtime_error("OccupancyAccumulator: " + error);
+        }
+
+        result_.merge(maps.merge());
+        std::cout << "OccupancyAccumulator: " << entries_.size() << " events with " << n_threads << " threads" << std::endl;
+        entries_.clear();
+    }
+
+    const OccupancyMap& get_true_map(int plane, int owner_class) const
+    {
+        return result_.true_hits.at(size_t(plane) * DisplayAssembler::kNumOwnerClasses + owner_class);
+    }
+
+    const OccupancyMap& get_slice_map(int plane) const { return result_.slice_hits.at(plane); }
+
+    // One TH2D per plane and owner class, plus the owner-summed and slice maps
+    void write(const std::string& output_name) const
+    {
+        TFile output(output_name.c_str(), "RECREATE");
+        const char* plane_names[kNumPlanes] = { "u", "v", "w" };
+        const char* plane_titles[kNumPlanes] = { "U", "V", "W" };
+        for (int p = 0; p < kNumPlanes; ++p) {
+            std::string plane = plane_names[p];
+            std::string axes = ";Drift Coordinate [cm];" + std::string(plane_titles[p]) + " Wire";
+
+            OccupancyMap all_true = get_true_map(p, DisplayAssembler::kNoOwner);
+            for (int c = DisplayAssembler::kOwnerMuon; c < DisplayAssembler::kNumOwnerClasses; ++c) {
+                const OccupancyMap& map = get_true_map(p, c);
+                all_true.merge(map);
+                std::string name = "occupancy_true_" + plane + "_" + DisplayAssembler::get_owner_class_name(c);
+                std::unique_ptr<TH2D> hist(map.to_th2d(name, axes));
+                hist->Write();
+            }
+
+            std::unique_ptr<TH2D> true_hist(all_true.to_th2d("occupancy_true_" + plane, axes));
+            true_hist->Write();
+            std::unique_ptr<TH2D> slice_hist(get_slice_map(p).to_th2d("occupancy_slice_" + plane, axes));
+            slice_hist->Write();
+        }
+        output.Close();
+    }
+
+private:
+    static constexpr int kNumWires[kNumPlanes] = { 2400, 2400, 3456 };
+
+    std::string input_name_;
+    std::vector<int> entries_;
+    PlaneMaps result_;
+
+    static void fill_event(const DisplayAssembler& assembler, PlaneMaps& maps)
+    {
+        for (int p = 0; p < kNumPlanes; ++p) {
+            DisplayAssembler::PlaneHits hits = assembler.get_plane(p);
+            OccupancyMap* by_owner = &maps.true_hits[size_t(p) * DisplayAssembler::kNumOwnerClasses];
+            for (size_t i = 0; i < hits.wire->size(); ++i)
+                by_owner[DisplayAssembler::get_owner_class(int(hits.owner->at(i)))].fill(hits.wire->at(i), hits.drift->at(i));
+
+            OccupancyMap& slice = maps.slice_hits[p];
+            for (size_t k = 0; k < hits.reco_wire->size(); ++k) {
+                const std::vector<float>& wires = hits.reco_wire->at(k);
+                const std::vector<float>& drifts = hits.reco_drift->at(k);
+                slice.fill_n(std::min(wires.size(), drifts.size()), wires.data(), drifts.data());
+            }
+        }
+    }
+};
+
+#endif // OCCUPANCYMAP_H
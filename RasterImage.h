@@ -0,0 +1,203 @@
+#ifndef RASTERIMAGE_H
+#define RASTERIMAGE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+// RGB pixel buffer with a dependency-free PNG writer, for displays drawn
+// straight from hit arrays instead of through TCanvas. Colours are 0xRRGGBB.
+// The PNG is written with stored (uncompressed) deflate blocks: larger files,
+// but no zlib and no compression cost on bulk thumbnails.
+class RasterImage
+{
+public:
+    RasterImage(int width = 0, int height = 0, uint32_t background = 0xFFFFFF)
+        : width_(width), height_(height), pixels_(size_t(std::max(width, 0)) * std::max(height, 0), background)
+    {
+        if (width < 0 || height < 0)
+            throw std::invalid_argument("RasterImage: negative image size");
+    }
+
+    int get_width() const { return width_; }
+    int get_height() const { return height_; }
+
+    // Out-of-range pixels are clipped
+    void set(int x, int y, uint32_t colour)
+    {
+        if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+        pixels_[size_t(y) * width_ + x] = colour;
+    }
+
+    uint32_t get(int x, int y) const { return pixels_[size_t(y) * width_ + x]; }
+
+    void fill_rect(int x0, int y0, int w, int h, uint32_t colour)
+    {
+        // Clip both ends first: a rectangle wholly off one side has an empty range
+        int xs = std::max(0, x0), xe = std::min(width_, x0 + w);
+        int ys = std::max(0, y0), ye = std::min(height_, y0 + h);
+        if (xe <= xs || ye <= ys) return;
+        for (int y = ys; y < ye; ++y)
+            std::fill(pixels_.begin() + size_t(y) * width_ + xs, pixels_.begin() + size_t(y) * width_ + xe, colour);
+    }
+
+    void draw_rect(int x0, int y0, int w, int h, uint32_t colour)
+    {
+        fill_rect(x0, y0, w, 1, colour);
+        fill_rect(x0, y0 + h - 1, w, 1, colour);
+        fill_rect(x0, y0, 1, h, colour);
+        fill_rect(x0 + w - 1, y0, 1, h, colour);
+    }
+
+    // Bresenham, clipped per pixel
+    void draw_line(int x0, int y0, int x1, int y1, uint32_t colour)
+    {
+        int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+        int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+        int err = dx + dy;
+        while (true) {
+            set(x0, y0, colour);
+            if (x0 == x1 && y0 == y1) return;
+            int e2 = 2 * err;
+            if (e2 >= dy) { err += dy; x0 += sx; }
+            if (e2 <= dx) { err += dx; y0 += sy; }
+        }
+    }
+
+    void blit(const RasterImage& source, int x0, int y0)
+    {
+        for (int y = 0; y < source.height_; ++y) {
+            for (int x = 0; x < source.width_; ++x) set(x0 + x, y0 + y, source.get(x, y));
+        }
+    }
+
+    // Panels laid out row by row, `columns` across, separated by `gap` pixels
+    static RasterImage tile(const std::vector<RasterImage>& panels, int columns, int gap = 2, uint32_t background = 0xFFFFFF)
+    {
+        if (panels.empty()) return RasterImage();
+        if (columns <= 0)
+            throw std::invalid_argument("RasterImage: montage needs at least one column");
+
+        int cell_w = 0, cell_h = 0;
+        for (const RasterImage& panel : panels) {
+            cell_w = std::max(cell_w, panel.width_);
+            cell_h = std::max(cell_h, panel.height_);
+        }
+
+        columns = std::min(columns, int(panels.size()));
+        int rows = (int(panels.size()) + columns - 1) / columns;
+        RasterImage montage(columns * cell_w + (columns - 1) * gap, rows * cell_h + (rows - 1) * gap, background);
+        for (size_t k = 0; k < panels.size(); ++k)
+            montage.blit(panels[k], int(k % columns) * (cell_w + gap), int(k / columns) * (cell_h + gap));
+        return montage;
+    }
+
+    void write_png(const std::string& path) const
+    {
+        // Filter byte 0 (none) ahead of every scanline
+        std::vector<uint8_t> raw;
+        raw.reserve(size_t(height_) * (size_t(width_) * 3 + 1));
+        for (int y = 0; y < height_; ++y) {
+            raw.push_back(0);
+            for (int x = 0; x < width_; ++x) {
+                uint32_t c = get(x, y);
+                raw.push_back(uint8_t(c >> 16));
+                raw.push_back(uint8_t(c >> 8));
+                raw.push_back(uint8_t(c));
+            }
+        }
+
+        std::vector<uint8_t> header;
+        put_u32(header, uint32_t(width_));
+        put_u32(header, uint32_t(height_));
+        header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit RGB, no interlace
+
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out)
+            throw std::runtime_error("RasterImage: cannot write '" + path + "'");
+
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::fwrite(signature, 1, 8, out);
+        write_chunk(out, "IHDR", header);
+        write_chunk(out, "IDAT", stored_zlib(raw));
+        write_chunk(out, "IEND", {});
+
+        bool failed = std::ferror(out) != 0;
+        if (std::fclose(out) != 0 || failed)
+            throw std::runtime_error("RasterImage: error writing '" + path + "'");
+    }
+
+private:
+    int width_;
+    int height_;
+    std::vector<uint32_t> pixels_;
+
+    static void put_u32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        out.insert(out.end(), { uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v) });
+    }
+
+    static uint32_t crc32(const uint8_t* data, size_t n, uint32_t crc)
+    {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        for (size_t i = 0; i < n; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    static std::vector<uint8_t> stored_zlib(const std::vector<uint8_t>& raw)
+    {
+        std::vector<uint8_t> out = { 0x78, 0x01 };
+        const size_t kMaxBlock = 65535;
+        size_t pos = 0;
+        do {
+            size_t n = std::min(kMaxBlock, raw.size() - pos);
+            bool last = pos + n == raw.size();
+            out.push_back(last ? 1 : 0);
+            out.push_back(uint8_t(n));
+            out.push_back(uint8_t(n >> 8));
+            out.push_back(uint8_t(~n));
+            out.push_back(uint8_t(~n >> 8));
+            out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + n);
+            pos += n;
+        } while (pos < raw.size());
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        put_u32(out, (b << 16) | a);
+        return out;
+    }
+
+    static void write_chunk(std::FILE* out, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> length;
+        put_u32(length, uint32_t(data.size()));
+        std::fwrite(length.data(), 1, 4, out);
+
+        uint32_t crc = crc32((const uint8_t*)type, 4, 0xFFFFFFFFu);
+        crc = crc32(data.data(), data.size(), crc) ^ 0xFFFFFFFFu;
+        std::fwrite(type, 1, 4, out);
+        if (!data.empty()) std::fwrite(data.data(), 1, data.size(), out);
+
+        std::vector<uint8_t> trailer;
+        put_u32(trailer, crc);
+        std::fwrite(trailer.data(), 1, 4, out);
+    }
+};
+
+#endif // RASTERIMAGE_H
@@ -0,0 +1,188 @@
+#ifndef RESIDENTTREE_H
+#define RESIDENTTREE_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+#include "MatchKernels.h"
+
+// Every numeric branch of a tree decoded into memory once: scalar branches
+// as one array each, vector<float> and vector<int> branches as jagged
+// batches. Other branch types (strings, nested vectors) are not loaded.
+class ResidentTree
+{
+public:
+    // An empty list loads every supported branch
+    ResidentTree(TTree& tree, const std::vector<std::string>& branches = {})
+        : num_entries_(tree.GetEntries())
+    {
+        std::vector<Slot> slots;
+        TObjArray* list = tree.GetListOfBranches();
+        for (int b = 0; list && b < list->GetEntries(); ++b) {
+            TBranch* branch = dynamic_cast<TBranch*>(list->At(b));
+            if (!branch) continue;
+
+            std::string name = branch->GetName();
+            if (!branches.empty() && std::find(branches.begin(), branches.end(), name) == branches.end()) continue;
+
+            Slot slot = classify(*branch);
+            if (slot.kind == kUnsupported || slot.kind == kString) continue;
+            slot.name = name;
+            slots.push_back(slot);
+        }
+
+        tree.SetBranchStatus("*", false);
+        for (Slot& slot : slots) {
+            tree.SetBranchStatus(slot.name.c_str(), true);
+            if (slot.kind == kScalar) {
+                tree.SetBranchAddress(slot.name.c_str(), (void*)&slot.buffer);
+                scalars_[slot.name].reserve(num_entries_);
+            }
+            else if (slot.kind == kFloatVector) {
+                tree.SetBranchAddress(slot.name.c_str(), &slot.floats);
+            }
+            else {
+                tree.SetBranchAddress(slot.name.c_str(), &slot.ints);
+            }
+        }
+
+        for (long long i = 0; i < num_entries_; ++i) {
+            tree.GetEntry(i);
+            for (Slot& slot : slots) {
+                if (slot.kind == kScalar) scalars_[slot.name].push_back(slot.to_double());
+                else if (slot.kind == kFloatVector) floats_[slot.name].append(*slot.floats);
+                else ints_[slot.name].append(*slot.ints);
+            }
+        }
+
+        // The tree keeps the addresses; detach them before the buffers go
+        tree.ResetBranchAddresses();
+        tree.SetBranchStatus("*", true);
+        for (Slot& slot : slots) {
+            delete slot.floats;
+            delete slot.ints;
+        }
+    }
+
+    long long get_num_entries() const { return num_entries_; }
+
+    bool has_scalar(const std::string& name) const { return scalars_.count(name) > 0; }
+    bool has_floats(const std::string& name) const { return floats_.count(name) > 0; }
+    bool has_ints(const std::string& name) const { return ints_.count(name) > 0; }
+
+    const std::vector<double>& get_scalar(const std::string& name) const { return find(scalars_, name); }
+    const match_kernels::JaggedBatch<float>& get_floats(const std::string& name) const { return find(floats_, name); }
+    const match_kernels::JaggedBatch<int>& get_ints(const std::string& name) const { return find(ints_, name); }
+
+    std::vector<std::string> get_branch_names() const
+    {
+        std::vector<std::string> names;
+        for (const auto& column : scalars_) names.push_back(column.first);
+        for (const auto& column : floats_) names.push_back(column.first);
+        for (const auto& column : ints_) names.push_back(column.first);
+        return names;
+    }
+
+    size_t get_memory_bytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& column : scalars_) bytes += column.second.capacity() * sizeof(double);
+        for (const auto& column : floats_) bytes += column.second.values.capacity() * sizeof(float) + column.second.offsets.capacity() * sizeof(int);
+        for (const auto& column : ints_) bytes += column.second.values.capacity() * sizeof(int) + column.second.offsets.capacity() * sizeof(int);
+        return bytes;
+    }
+
+    // Branch decoding, shared with CompressedTable
+    enum Kind { kUnsupported, kScalar, kFloatVector, kIntVector, kString };
+    enum ScalarType { kFloat, kDouble, kInt, kUInt, kBool, kShort, kUShort, kChar, kUChar, kLong64, kULong64 };
+
+    // Read buffer for one branch; scalars land in an 8-byte union
+    struct Slot
+    {
+        std::string name;
+        Kind kind = kUnsupported;
+        ScalarType type = kDouble;
+        union { Float_t f; Double_t d; Int_t i; UInt_t u; Bool_t o; Short_t s; UShort_t us; Char_t c; UChar_t uc; Long64_t l; ULong64_t ul; } buffer;
+        std::vector<float>* floats = nullptr;
+        std::vector<int>* ints = nullptr;
+        std::string* text = nullptr;
+
+        double to_double() const
+        {
+            switch (type) {
+            case kFloat: return buffer.f;
+            case kDouble: return buffer.d;
+            case kInt: return buffer.i;
+            case kUInt: return buffer.u;
+            case kBool: return buffer.o;
+            case kShort: return buffer.s;
+            case kUShort: return buffer.us;
+            case kChar: return buffer.c;
+            case kUChar: return buffer.uc;
+            case kLong64: return double(buffer.l);
+            case kULong64: return double(buffer.ul);
+            }
+            return 0;
+        }
+    };
+
+    static Slot classify(TBranch& branch)
+    {
+        Slot slot;
+        std::string class_name = branch.GetClassName();
+        if (class_name == "vector<float>") {
+            slot.kind = kFloatVector;
+            return slot;
+        }
+        if (class_name == "vector<int>") {
+            slot.kind = kIntVector;
+            return slot;
+        }
+        if (class_name == "string") {
+            slot.kind = kString;
+            return slot;
+        }
+        if (!class_name.empty()) return slot;
+
+        // Plain leaf branches: exactly one scalar leaf
+        TObjArray* leaves = branch.GetListOfLeaves();
+        if (!leaves || leaves->GetEntries() != 1) return slot;
+        TLeaf* leaf = dynamic_cast<TLeaf*>(leaves->At(0));
+        if (!leaf || leaf->GetLen() != 1) return slot;
+
+        static const std::map<std::string, ScalarType> types = {
+            {"Float_t", kFloat}, {"Double_t", kDouble}, {"Int_t", kInt}, {"UInt_t", kUInt}, {"Bool_t", kBool},
+            {"Short_t", kShort}, {"UShort_t", kUShort}, {"Char_t", kChar}, {"UChar_t", kUChar},
+            {"Long64_t", kLong64}, {"ULong64_t", kULong64}
+        };
+        auto it = types.find(leaf->GetTypeName());
+        if (it == types.end()) return slot;
+
+        slot.kind = kScalar;
+        slot.type = it->second;
+        return slot;
+    }
+
+private:
+    long long num_entries_;
+    std::map<std::string, std::vector<double>> scalars_;
+    std::map<std::string, match_kernels::JaggedBatch<float>> floats_;
+    std::map<std::string, match_kernels::JaggedBatch<int>> ints_;
+
+    template <typename C> static const typename C::mapped_type& find(const C& columns, const std::string& name)
+    {
+        auto it = columns.find(name);
+        if (it == columns.end())
+            throw std::invalid_argument("ResidentTree: no resident column '" + name + "'");
+        return it->second;
+    }
+};
+
+#endif // RESIDENTTREE_H
@@ -6,10 +6,19 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <tuple>
+#include <memory_resource>
+
+#include "EventArena.h"
 
 class SliceAssembler
 {
 public:
+    // Built in the calling thread's EventArena; valid until the next entry is read
+    typedef std::pmr::map<std::pmr::string, float> Properties;
+    typedef std::pmr::map<int, Properties> SliceMap;
+    typedef std::pmr::vector<Properties> FlashList;
+
     inline static const SliceAssembler& instance(const std::string& input_name)
     {
         static std::unique_ptr<SliceAssembler> the_instance(new SliceAssembler(input_name));
@@ -35,93 +44,59 @@ public:
         }
     }
 
-    std::vector<std::map<std::string, float>> get_flashes(int i) const
+    FlashList get_flashes(int i) const
     {
-        std::vector<std::map<std::string, float>> flashes;
-        tree_->GetEntry(i); 
+        std::pmr::memory_resource* arena = read_entry(i);
+        FlashList flashes(arena);
 
         for (size_t j = 0; j < _flash_time_v->size(); ++j)
         {
-            std::map<std::string, float> flash_data = {
-                {"time", _flash_time_v->at(j)},
-                {"total_pe", _flash_total_pe_v->at(j)},
-                {"center_y", _flash_center_y_v->at(j)},
-                {"center_z", _flash_center_z_v->at(j)},
-                {"width_y", _flash_width_y_v->at(j)},
-                {"width_z", _flash_width_z_v->at(j)}
-            };
-
-            flashes.push_back(flash_data);
+            Properties& flash_data = flashes.emplace_back();
+            flash_data["time"] = _flash_time_v->at(j);
+            flash_data["total_pe"] = _flash_total_pe_v->at(j);
+            flash_data["center_y"] = _flash_center_y_v->at(j);
+            flash_data["center_z"] = _flash_center_z_v->at(j);
+            flash_data["width_y"] = _flash_width_y_v->at(j);
+            flash_data["width_z"] = _flash_width_z_v->at(j);
         }
 
         return flashes;
     }
 
-    const std::map<int, std::map<std::string, float>>& get_slices(int i) const
+    SliceMap get_slices(int i) const
     {
-        slices_.clear();  
-
-        tree_->GetEntry(i);
-            
-        for (size_t j = 0; j < _slice_ids_v->size(); ++j)
-        {
-            slices_[_slice_ids_v->at(j)] = {
-                {"completeness", _slice_completeness_v->at(j)},
-                {"purity", _slice_purity_v->at(j)},
-                {"topological_score", _slice_topological_score_v->at(j)},
-                {"pandora_score", _slice_pandora_score_v->at(j)},
-                {"center_x", _slice_center_x_v->at(j)},
-                {"center_y", _slice_center_y_v->at(j)},
-                {"center_z", _slice_center_z_v->at(j)},
-                {"charge", _slice_charge_v->at(j)},
-                {"n_hits", _slice_n_hits_v->at(j)}
-            };
-        }
-
-        return slices_;
+        std::pmr::memory_resource* arena = read_entry(i);
+        SliceMap slices(arena);
+        fill_slices(slices);
+        return slices;
     }
 
-    std::tuple<std::map<std::string, float>, std::map<std::string, float>, std::map<std::string, float>> get_defined_slices(int i) const
+    std::tuple<Properties, Properties, Properties> get_defined_slices(int i) const
     {
-        slices_.clear();  
-
-        tree_->GetEntry(i);
-            
-        for (size_t j = 0; j < _slice_ids_v->size(); ++j)
-        {
-            slices_[_slice_ids_v->at(j)] = {
-                {"completeness", _slice_completeness_v->at(j)},
-                {"purity", _slice_purity_v->at(j)},
-                {"topological_score", _slice_topological_score_v->at(j)},
-                {"pandora_score", _slice_pandora_score_v->at(j)},
-                {"center_x", _slice_center_x_v->at(j)},
-                {"center_y", _slice_center_y_v->at(j)},
-                {"center_z", _slice_center_z_v->at(j)},
-                {"charge", _slice_charge_v->at(j)},
-                {"n_hits", _slice_n_hits_v->at(j)}
-            };
-        }
+        std::pmr::memory_resource* arena = read_entry(i);
+        SliceMap slices(arena);
+        fill_slices(slices);
 
-        std::map<std::string, float> true_slice_properties;
-        std::map<std::string, float> pandora_slice_properties;
-        std::map<std::string, float> flash_slice_properties;
+        Properties true_slice_properties(arena);
+        Properties pandora_slice_properties(arena);
+        Properties flash_slice_properties(arena);
 
-        auto true_slice_it = slices_.find(_true_nu_slice_id);
-        if (true_slice_it != slices_.end()) {
+        auto true_slice_it = slices.find(_true_nu_slice_id);
+        if (true_slice_it != slices.end()) {
             true_slice_properties = true_slice_it->second;
         }
 
-        auto pandora_slice_it = slices_.find(_pandora_nu_slice_id);
-        if (pandora_slice_it != slices_.end()) {
+        auto pandora_slice_it = slices.find(_pandora_nu_slice_id);
+        if (pandora_slice_it != slices.end()) {
             pandora_slice_properties = pandora_slice_it->second;
         }
 
-        auto flash_slice_it = slices_.find(_flash_match_nu_slice_id);
-        if (flash_slice_it != slices_.end()) {
+        auto flash_slice_it = slices.find(_flash_match_nu_slice_id);
+        if (flash_slice_it != slices.end()) {
             flash_slice_properties = flash_slice_it->second;
         }
 
-        return std::make_tuple(true_slice_properties, pandora_slice_properties, flash_slice_properties);
+        return std::make_tuple(std::move(true_slice_properties), std::move(pandora_slice_properties), std::move(flash_slice_properties));
     }
 
     TVector3 get_true_nu_vertex() const
@@ -203,7 +178,30 @@ private:
     float _flash_reco_nu_vtx_y;
     float _flash_reco_nu_vtx_z;
 
-    mutable std::map<int, std::map<std::string, float>> slices_;
+    std::pmr::memory_resource* read_entry(int i) const
+    {
+        EventArena& arena = EventArena::local();
+        arena.begin_entry(i);
+        tree_->GetEntry(i);
+        return arena.resource();
+    }
+
+    void fill_slices(SliceMap& slices) const
+    {
+        for (size_t j = 0; j < _slice_ids_v->size(); ++j)
+        {
+            Properties& slice = slices[_slice_ids_v->at(j)];
+            slice["completeness"] = _slice_completeness_v->at(j);
+            slice["purity"] = _slice_purity_v->at(j);
+            slice["topological_score"] = _slice_topological_score_v->at(j);
+            slice["pandora_score"] = _slice_pandora_score_v->at(j);
+            slice["center_x"] = _slice_center_x_v->at(j);
+            slice["center_y"] = _slice_center_y_v->at(j);
+            slice["center_z"] = _slice_center_z_v->at(j);
+            slice["charge"] = _slice_charge_v->at(j);
+            slice["n_hits"] = _slice_n_hits_v->at(j);
+        }
+    }
 
     void set_branch_addresses()
     {
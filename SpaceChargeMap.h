@@ -0,0 +1,272 @@
+#ifndef SPACECHARGEMAP_H
+#define SPACECHARGEMAP_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TFile.h"
+#include "TH3.h"
+
+#include "WirePlaneGeometry.h"
+
+// Space-charge displacement map on a regular 3D grid, applied to arrays of
+// points with trilinear interpolation. The forward map takes a true position
+// to where its charge is reconstructed, reco = true + D_forward(true); the
+// backward map undoes it, true = reco + D_backward(reco).
+//
+// Each grid node stores its (dx, dy, dz) displacement padded to 16 bytes,
+// with x running fastest, so the eight corners of a cell lie in four pairs of
+// adjacent nodes and nearby points (consecutive trajectory points) reuse the
+// same cache lines. Points outside the grid take the displacement of the
+// nearest face.
+class SpaceChargeMap
+{
+public:
+    enum Direction { kForward, kBackward };
+
+    // Node displacements in (dx, dy, dz) triples, x fastest then y then z.
+    // An empty backward map is replaced by a fixed-point inversion of the
+    // forward map.
+    SpaceChargeMap(int nx, int ny, int nz, const float origin[3], const float spacing[3],
+                   const std::vector<float>& forward, const std::vector<float>& backward = {})
+        : nx_(nx), ny_(ny), nz_(nz)
+    {
+        if (nx < 2 || ny < 2 || nz < 2)
+            throw std::invalid_argument("SpaceChargeMap: need at least two nodes along each axis");
+        for (int a = 0; a < 3; ++a) {
+            if (!(spacing[a] > 0))
+                throw std::invalid_argument("SpaceChargeMap: node spacing must be positive");
+            origin_[a] = origin[a];
+            inverse_spacing_[a] = 1.0f / spacing[a];
+        }
+
+        size_t n_nodes = size_t(nx) * ny * nz;
+        if (forward.size() != 3 * n_nodes || (!backward.empty() && backward.size() != 3 * n_nodes))
+            throw std::invalid_argument("SpaceChargeMap: displacement arrays do not match the grid");
+
+        forward_ = pack(forward);
+        if (!backward.empty()) backward_ = pack(backward);
+    }
+
+    // Reads one TH3 per displacement component, sampled at the bin centres,
+    // which must be uniformly spaced. The backward histograms are optional.
+    static SpaceChargeMap load(const std::string& input_name,
+                               const std::vector<std::string>& forward_names = { "hDx", "hDy", "hDz" },
+                               const std::vector<std::string>& backward_names = {})
+    {
+        std::unique_ptr<TFile> input(TFile::Open(input_name.c_str(), "READ"));
+        if (!input || input->IsZombie())
+            throw std::invalid_argument("SpaceChargeMap: cannot open '" + input_name + "'");
+
+        std::vector<const TH3*> forward_hists = get_components(*input, input_name, forward_names);
+        const TH3* reference = forward_hists[0];
+        int nx = reference->GetNbinsX(), ny = reference->GetNbinsY(), nz = reference->GetNbinsZ();
+        const TAxis* axes[3] = { reference->GetXaxis(), reference->GetYaxis(), reference->GetZaxis() };
+
+        float origin[3], spacing[3];
+        for (int a = 0; a < 3; ++a) {
+            if (axes[a]->IsVariableBinSize())
+                throw std::invalid_argument("SpaceChargeMap: '" + forward_names[0] + "' is not uniformly binned");
+            origin[a] = float(axes[a]->GetBinCenter(1));
+            spacing[a] = float((axes[a]->GetXmax() - axes[a]->GetXmin()) / axes[a]->GetNbins());
+        }
+
+        std::vector<float> forward = read_components(forward_hists, nx, ny, nz);
+        std::vector<float> backward;
+        if (!backward_names.empty()) {
+            std::vector<const TH3*> backward_hists = get_components(*input, input_name, backward_names);
+            if (backward_hists[0]->GetNbinsX() != nx || backward_hists[0]->GetNbinsY() != ny || backward_hists[0]->GetNbinsZ() != nz)
+                throw std::invalid_argument("SpaceChargeMap: backward and forward maps are binned differently");
+            backward = read_components(backward_hists, nx, ny, nz);
+        }
+
+        return SpaceChargeMap(nx, ny, nz, origin, spacing, forward, backward);
+    }
+
+    bool has_backward_map() const { return !backward_.empty(); }
+
+    // Displacement at one point, without applying it
+    void get_offset(Direction direction, float x, float y, float z, float offset[3]) const
+    {
+        if (direction == kForward || has_backward_map()) {
+            interpolate(direction == kForward ? forward_ : backward_, x, y, z, offset);
+            return;
+        }
+
+        float corrected[3] = { x, y, z };
+        invert(corrected);
+        offset[0] = corrected[0] - x;
+        offset[1] = corrected[1] - y;
+        offset[2] = corrected[2] - z;
+    }
+
+    // Moves the points (x[i], y[i], z[i]) in place
+    void apply(Direction direction, float* x, float* y, float* z, size_t n) const
+    {
+        float offset[3];
+        if (direction == kForward || has_backward_map()) {
+            const std::vector<Node>& nodes = direction == kForward ? forward_ : backward_;
+            for (size_t i = 0; i < n; ++i) {
+                interpolate(nodes, x[i], y[i], z[i], offset);
+                x[i] += offset[0];
+                y[i] += offset[1];
+                z[i] += offset[2];
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            float point[3] = { x[i], y[i], z[i] };
+            invert(point);
+            x[i] = point[0];
+            y[i] = point[1];
+            z[i] = point[2];
+        }
+    }
+
+    void apply(Direction direction, std::vector<float>& x, std::vector<float>& y, std::vector<float>& z) const
+    {
+        if (x.size() != y.size() || x.size() != z.size())
+            throw std::invalid_argument("SpaceChargeMap: coordinate arrays differ in length");
+        apply(direction, x.data(), y.data(), z.data(), x.size());
+    }
+
+    // Both end points of every segment, gathered into one batch
+    void apply(Direction direction, std::vector<TruthSegment>& segments) const
+    {
+        size_t n = 2 * segments.size();
+        std::vector<float> x(n), y(n), z(n);
+        for (size_t k = 0; k < segments.size(); ++k) {
+            for (int end = 0; end < 2; ++end) {
+                const float* point = end == 0 ? segments[k].start : segments[k].end;
+                x[2 * k + end] = point[0];
+                y[2 * k + end] = point[1];
+                z[2 * k + end] = point[2];
+            }
+        }
+
+        apply(direction, x.data(), y.data(), z.data(), n);
+
+        for (size_t k = 0; k < segments.size(); ++k) {
+            for (int end = 0; end < 2; ++end) {
+                float* point = end == 0 ? segments[k].start : segments[k].end;
+                point[0] = x[2 * k + end];
+                point[1] = y[2 * k + end];
+                point[2] = z[2 * k + end];
+            }
+        }
+    }
+
+private:
+    struct alignas(16) Node
+    {
+        float d[4];
+    };
+
+    // Fixed-point steps of true = reco - D_forward(true); the map varies
+    // slowly on the scale of the displacement, so this converges quickly
+    static constexpr int kInversionSteps = 4;
+
+    int nx_, ny_, nz_;
+    float origin_[3];
+    float inverse_spacing_[3];
+    std::vector<Node> forward_;
+    std::vector<Node> backward_;
+
+    static std::vector<Node> pack(const std::vector<float>& displacements)
+    {
+        std::vector<Node> nodes(displacements.size() / 3);
+        for (size_t k = 0; k < nodes.size(); ++k)
+            nodes[k] = Node{ { displacements[3 * k], displacements[3 * k + 1], displacements[3 * k + 2], 0.f } };
+        return nodes;
+    }
+
+    // Cell index along one axis, clamped so the fraction stays in [0, 1]
+    static int locate(float u, int n, float& fraction)
+    {
+        if (!(u > 0)) {
+            fraction = 0;
+            return 0;
+        }
+        if (u >= n - 1) {
+            fraction = 1;
+            return n - 2;
+        }
+        int i = int(u);
+        fraction = u - i;
+        return i;
+    }
+
+    void interpolate(const std::vector<Node>& nodes, float x, float y, float z, float offset[3]) const
+    {
+        float fx, fy, fz;
+        int ix = locate((x - origin_[0]) * inverse_spacing_[0], nx_, fx);
+        int iy = locate((y - origin_[1]) * inverse_spacing_[1], ny_, fy);
+        int iz = locate((z - origin_[2]) * inverse_spacing_[2], nz_, fz);
+
+        const size_t stride_y = size_t(nx_), stride_z = size_t(nx_) * ny_;
+        const Node* c = &nodes[iz * stride_z + iy * stride_y + ix];
+        const Node* c00 = c;
+        const Node* c10 = c + stride_y;
+        const Node* c01 = c + stride_z;
+        const Node* c11 = c + stride_z + stride_y;
+
+        for (int a = 0; a < 3; ++a) {
+            float e00 = c00[0].d[a] + fx * (c00[1].d[a] - c00[0].d[a]);
+            float e10 = c10[0].d[a] + fx * (c10[1].d[a] - c10[0].d[a]);
+            float e01 = c01[0].d[a] + fx * (c01[1].d[a] - c01[0].d[a]);
+            float e11 = c11[0].d[a] + fx * (c11[1].d[a] - c11[0].d[a]);
+            float e0 = e00 + fy * (e10 - e00);
+            float e1 = e01 + fy * (e11 - e01);
+            offset[a] = e0 + fz * (e1 - e0);
+        }
+    }
+
+    void invert(float point[3]) const
+    {
+        const float reco[3] = { point[0], point[1], point[2] };
+        float offset[3];
+        for (int step = 0; step < kInversionSteps; ++step) {
+            interpolate(forward_, point[0], point[1], point[2], offset);
+            for (int a = 0; a < 3; ++a) point[a] = reco[a] - offset[a];
+        }
+    }
+
+    static std::vector<const TH3*> get_components(TFile& input, const std::string& input_name, const std::vector<std::string>& names)
+    {
+        if (names.size() != 3)
+            throw std::invalid_argument("SpaceChargeMap: expected x, y and z displacement histograms");
+
+        std::vector<const TH3*> hists;
+        for (const std::string& name : names) {
+            const TH3* hist = dynamic_cast<const TH3*>(input.Get(name.c_str()));
+            if (!hist)
+                throw std::invalid_argument("SpaceChargeMap: '" + input_name + "' has no TH3 '" + name + "'");
+            if (!hists.empty() && (hist->GetNbinsX() != hists[0]->GetNbinsX() || hist->GetNbinsY() != hists[0]->GetNbinsY() ||
+                                   hist->GetNbinsZ() != hists[0]->GetNbinsZ()))
+                throw std::invalid_argument("SpaceChargeMap: '" + name + "' is binned differently from '" + names[0] + "'");
+            hists.push_back(hist);
+        }
+        return hists;
+    }
+
+    static std::vector<float> read_components(const std::vector<const TH3*>& hists, int nx, int ny, int nz)
+    {
+        std::vector<float> displacements(size_t(nx) * ny * nz * 3);
+        size_t k = 0;
+        for (int iz = 1; iz <= nz; ++iz) {
+            for (int iy = 1; iy <= ny; ++iy) {
+                for (int ix = 1; ix <= nx; ++ix) {
+                    for (int a = 0; a < 3; ++a) displacements[k++] = float(hists[a]->GetBinContent(ix, iy, iz));
+                }
+            }
+        }
+        return displacements;
+    }
+};
+
+#endif // SPACECHARGEMAP_H
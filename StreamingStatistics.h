@@ -0,0 +1,265 @@
+#ifndef STREAMINGSTATISTICS_H
+#define STREAMINGSTATISTICS_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Weighted Welford accumulator; merges with the Chan et al. pairwise update so
+// per-thread or per-file partials combine exactly.
+class RunningStatistics
+{
+public:
+    RunningStatistics()
+        : n_(0), sum_w_(0.0), mean_(0.0), m2_(0.0),
+          min_(std::numeric_limits<double>::max()), max_(std::numeric_limits<double>::lowest()) {}
+
+    void fill(double x, double w = 1.0)
+    {
+        if (w <= 0) return;
+
+        n_++;
+        sum_w_ += w;
+        double delta = x - mean_;
+        mean_ += delta * w / sum_w_;
+        m2_ += w * delta * (x - mean_);
+        min_ = std::min(min_, x);
+        max_ = std::max(max_, x);
+    }
+
+    void merge(const RunningStatistics& other)
+    {
+        if (other.sum_w_ == 0) return;
+        if (sum_w_ == 0) {
+            *this = other;
+            return;
+        }
+
+        double sum_w = sum_w_ + other.sum_w_;
+        double delta = other.mean_ - mean_;
+        mean_ += delta * other.sum_w_ / sum_w;
+        m2_ += other.m2_ + delta * delta * sum_w_ * other.sum_w_ / sum_w;
+        sum_w_ = sum_w;
+        n_ += other.n_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    long get_entries() const { return n_; }
+    double get_sum_of_weights() const { return sum_w_; }
+    double get_mean() const { return mean_; }
+    double get_min() const { return min_; }
+    double get_max() const { return max_; }
+
+    // Sample variance, treating weights as frequencies
+    double get_variance() const { return (sum_w_ > 1) ? m2_ / (sum_w_ - 1) : 0.0; }
+    double get_stddev() const { return std::sqrt(get_variance()); }
+    double get_error_on_mean() const { return (sum_w_ > 0) ? std::sqrt(get_variance() / sum_w_) : 0.0; }
+
+private:
+    long n_;
+    double sum_w_;
+    double mean_;
+    double m2_;
+    double min_, max_;
+};
+
+// Merging t-digest (Dunning & Ertl) with the arcsine scale function: bounded
+// memory set by the compression, accurate tails, and mergeable partials.
+class TDigest
+{
+public:
+    TDigest(double compression = 100.)
+        : compression_(compression), total_weight_(0.0),
+          min_(std::numeric_limits<double>::max()), max_(std::numeric_limits<double>::lowest())
+    {
+        if (compression_ < 10)
+            throw std::invalid_argument("TDigest: compression must be at least 10");
+
+        buffer_limit_ = size_t(5 * compression_);
+        buffer_.reserve(buffer_limit_);
+    }
+
+    void fill(double x, double w = 1.0)
+    {
+        if (w <= 0 || std::isnan(x)) return;
+
+        buffer_.push_back({x, w});
+        min_ = std::min(min_, x);
+        max_ = std::max(max_, x);
+        if (buffer_.size() >= buffer_limit_) compress();
+    }
+
+    void merge(const TDigest& other)
+    {
+        other.compress();
+        compress();
+
+        buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        compress();
+    }
+
+    double get_quantile(double q) const
+    {
+        compress();
+        if (centroids_.empty()) return 0.0;
+        if (centroids_.size() == 1) return centroids_[0].mean;
+
+        q = std::min(std::max(q, 0.0), 1.0);
+        double index = q * total_weight_;
+
+        // Centroid means sit at the middle of their weight; the ends are pinned to min and max
+        const Centroid& first = centroids_.front();
+        if (index < first.weight / 2)
+            return min_ + (first.mean - min_) * index / (first.weight / 2);
+
+        double cumulative = first.weight / 2;
+        for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+            double step = (centroids_[i].weight + centroids_[i + 1].weight) / 2;
+            if (index < cumulative + step) {
+                double t = (index - cumulative) / step;
+                return centroids_[i].mean + t * (centroids_[i + 1].mean - centroids_[i].mean);
+            }
+            cumulative += step;
+        }
+
+        const Centroid& last = centroids_.back();
+        double tail = total_weight_ - cumulative;
+        return (tail > 0) ? last.mean + (max_ - last.mean) * (index - cumulative) / tail : max_;
+    }
+
+    double get_median() const { return get_quantile(0.5); }
+
+    double get_total_weight() const
+    {
+        compress();
+        return total_weight_;
+    }
+
+    size_t get_num_centroids() const
+    {
+        compress();
+        return centroids_.size();
+    }
+
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    double compression_;
+    size_t buffer_limit_;
+
+    mutable std::vector<Centroid> centroids_;
+    mutable std::vector<Centroid> buffer_;
+    mutable double total_weight_;
+    double min_, max_;
+
+    double max_quantile_after(double q) const
+    {
+        const double pi = 3.14159265358979323846;
+        double k = compression_ / (2 * pi) * std::asin(2 * q - 1) + 1;
+        if (k >= compression_ / 4) return 1.0;
+        return (std::sin(k * 2 * pi / compression_) + 1) / 2;
+    }
+
+    void compress() const
+    {
+        if (buffer_.empty()) return;
+
+        buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+        std::sort(buffer_.begin(), buffer_.end(),
+                  [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+        double total = 0.0;
+        for (const Centroid& c : buffer_) total += c.weight;
+
+        centroids_.clear();
+        Centroid current = buffer_[0];
+        double weight_so_far = 0.0;
+        double q_limit = max_quantile_after(0.0);
+
+        for (size_t i = 1; i < buffer_.size(); ++i) {
+            const Centroid& next = buffer_[i];
+            if ((weight_so_far + current.weight + next.weight) / total <= q_limit) {
+                current.weight += next.weight;
+                current.mean += (next.mean - current.mean) * next.weight / current.weight;
+            }
+            else {
+                weight_so_far += current.weight;
+                centroids_.push_back(current);
+                q_limit = max_quantile_after(weight_so_far / total);
+                current = next;
+            }
+        }
+        centroids_.push_back(current);
+
+        total_weight_ = total;
+        buffer_.clear();
+    }
+};
+
+// Running statistics, and optionally a quantile sketch, in each bin of a
+// uniformly binned variable: e.g. resolution (y) against true energy (x).
+class BinnedStatistics
+{
+public:
+    BinnedStatistics(int n_bins, double x_min, double x_max, bool with_quantiles = false, double compression = 100.)
+        : n_bins_(n_bins), x_min_(x_min), x_max_(x_max), with_quantiles_(with_quantiles),
+          statistics_(n_bins + 2)
+    {
+        if (with_quantiles_) quantiles_.assign(n_bins + 2, TDigest(compression));
+    }
+
+    // Bin 0 is underflow and bin n_bins + 1 is overflow, as in ROOT
+    int find_bin(double x) const
+    {
+        if (!(x >= x_min_)) return 0;
+        if (x >= x_max_) return n_bins_ + 1;
+        int bin = 1 + int((x - x_min_) * n_bins_ / (x_max_ - x_min_));
+        return (bin > n_bins_) ? n_bins_ : bin;
+    }
+
+    void fill(double x, double y, double w = 1.0)
+    {
+        int bin = find_bin(x);
+        statistics_[bin].fill(y, w);
+        if (with_quantiles_) quantiles_[bin].fill(y, w);
+    }
+
+    void merge(const BinnedStatistics& other)
+    {
+        if (other.n_bins_ != n_bins_ || other.x_min_ != x_min_ || other.x_max_ != x_max_ || other.with_quantiles_ != with_quantiles_)
+            throw std::invalid_argument("BinnedStatistics: cannot merge accumulators with different binning");
+
+        for (size_t i = 0; i < statistics_.size(); ++i) statistics_[i].merge(other.statistics_[i]);
+        for (size_t i = 0; i < quantiles_.size(); ++i) quantiles_[i].merge(other.quantiles_[i]);
+    }
+
+    const RunningStatistics& get_statistics(int bin) const { return statistics_.at(bin); }
+
+    const TDigest& get_quantiles(int bin) const
+    {
+        if (!with_quantiles_)
+            throw std::logic_error("BinnedStatistics: quantiles were not requested");
+        return quantiles_.at(bin);
+    }
+
+    int get_num_bins() const { return n_bins_; }
+    double get_bin_center(int bin) const { return x_min_ + (bin - 0.5) * (x_max_ - x_min_) / n_bins_; }
+
+private:
+    int n_bins_;
+    double x_min_, x_max_;
+    bool with_quantiles_;
+    std::vector<RunningStatistics> statistics_;
+    std::vector<TDigest> quantiles_;
+};
+
+#endif // STREAMINGSTATISTICS_H
@@ -0,0 +1,48 @@
+#ifndef STRINGDICTIONARY_H
+#define STRINGDICTIONARY_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Interns strings as dense integer codes in order of first appearance, so
+// the strings themselves can be compared and indexed as small integers
+class StringDictionary
+{
+public:
+    uint32_t intern(const std::string& value)
+    {
+        auto it = lookup_.find(value);
+        if (it != lookup_.end()) return it->second;
+
+        uint32_t code = uint32_t(strings_.size());
+        lookup_.emplace(value, code);
+        strings_.push_back(value);
+        return code;
+    }
+
+    // Code of a string, or -1 if it was never interned
+    long find(const std::string& value) const
+    {
+        auto it = lookup_.find(value);
+        return it == lookup_.end() ? -1 : long(it->second);
+    }
+
+    const std::string& get(uint32_t code) const { return strings_.at(code); }
+    size_t size() const { return strings_.size(); }
+    const std::vector<std::string>& get_strings() const { return strings_; }
+
+    size_t get_memory_bytes() const
+    {
+        size_t bytes = 0;
+        for (const std::string& value : strings_) bytes += 2 * (value.capacity() + sizeof(std::string));
+        return bytes;
+    }
+
+private:
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> lookup_;
+};
+
+#endif // STRINGDICTIONARY_H
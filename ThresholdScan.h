@@ -0,0 +1,154 @@
+#ifndef THRESHOLDSCAN_H
+#define THRESHOLDSCAN_H
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+struct ThresholdScanPoint
+{
+    double threshold;
+    int n_selected;
+    int n_total;
+    double mean_purity;
+    double mean_completeness;
+    double efficiency;
+    double efficiency_error;
+};
+
+// Collects one (n_hits, purity, completeness) candidate per true particle in a
+// single pass, then answers "n_hits > threshold" queries from suffix sums
+// over the hit-sorted candidates instead of re-reading the events per cut.
+class ThresholdScan
+{
+public:
+    ThresholdScan() : n_total_(0), finalised_(false), key_mode_(kKeysUnset) {}
+
+    // The key identifies the event (e.g. its entry number) for resampling.
+    // Either every call passes a key or none does, in which case candidates
+    // are numbered in order; mixing the two could give unrelated candidates
+    // the same key.
+    void add_candidate(int n_hits, float purity, float completeness, long key = -1)
+    {
+        KeyMode mode = (key < 0) ? kAutoKeys : kExplicitKeys;
+        if (key_mode_ != kKeysUnset && key_mode_ != mode)
+            throw std::invalid_argument("ThresholdScan: candidates must all have explicit keys or all use the default");
+        key_mode_ = mode;
+
+        candidates_.push_back({n_hits, purity, completeness, (key < 0) ? long(candidates_.size()) : key});
+        n_total_++;
+        finalised_ = false;
+    }
+
+    void add_unmatched()
+    {
+        n_total_++;
+    }
+
+    void finalise()
+    {
+        std::sort(candidates_.begin(), candidates_.end(),
+                  [](const Candidate& a, const Candidate& b) { return a.n_hits < b.n_hits; });
+
+        size_t n = candidates_.size();
+        n_hits_.resize(n);
+        purity_.resize(n);
+        completeness_.resize(n);
+        keys_.resize(n);
+        purity_suffix_.assign(n + 1, 0.0);
+        completeness_suffix_.assign(n + 1, 0.0);
+
+        for (size_t i = 0; i < n; ++i) {
+            n_hits_[i] = candidates_[i].n_hits;
+            purity_[i] = candidates_[i].purity;
+            completeness_[i] = candidates_[i].completeness;
+            keys_[i] = candidates_[i].key;
+        }
+
+        for (size_t i = n; i-- > 0;) {
+            purity_suffix_[i] = purity_suffix_[i + 1] + purity_[i];
+            completeness_suffix_[i] = completeness_suffix_[i + 1] + completeness_[i];
+        }
+
+        finalised_ = true;
+    }
+
+    // Index of the first candidate with n_hits strictly above the threshold
+    size_t first_selected(double threshold) const
+    {
+        check_finalised();
+        return std::upper_bound(n_hits_.begin(), n_hits_.end(), threshold,
+                                [](double t, int h) { return t < h; }) - n_hits_.begin();
+    }
+
+    ThresholdScanPoint evaluate(double threshold) const
+    {
+        ThresholdScanPoint point;
+        size_t first = first_selected(threshold);
+        int n_selected = int(n_hits_.size() - first);
+
+        point.threshold = threshold;
+        point.n_selected = n_selected;
+        point.n_total = n_total_;
+        point.mean_purity = (n_selected > 0) ? purity_suffix_[first] / n_selected : 0.0;
+        point.mean_completeness = (n_selected > 0) ? completeness_suffix_[first] / n_selected : 0.0;
+        point.efficiency = (n_total_ > 0) ? double(n_selected) / n_total_ : 0.0;
+        point.efficiency_error = (n_total_ > 0) ? std::sqrt(point.efficiency * (1 - point.efficiency) / n_total_) : 0.0;
+
+        return point;
+    }
+
+    std::vector<ThresholdScanPoint> evaluate(const std::vector<double>& thresholds) const
+    {
+        std::vector<ThresholdScanPoint> points;
+        points.reserve(thresholds.size());
+        for (double threshold : thresholds) {
+            points.push_back(evaluate(threshold));
+        }
+        return points;
+    }
+
+    bool is_finalised() const { return finalised_; }
+    int get_num_total() const { return n_total_; }
+    size_t get_num_candidates() const { check_finalised(); return n_hits_.size(); }
+
+    // Sorted by n_hits after finalise(); [first_selected(t), end) passes the cut
+    const std::vector<int>& get_n_hits() const { check_finalised(); return n_hits_; }
+    const std::vector<float>& get_purity() const { check_finalised(); return purity_; }
+    const std::vector<float>& get_completeness() const { check_finalised(); return completeness_; }
+    const std::vector<long>& get_keys() const { check_finalised(); return keys_; }
+
+private:
+    enum KeyMode { kKeysUnset, kAutoKeys, kExplicitKeys };
+
+    struct Candidate
+    {
+        int n_hits;
+        float purity;
+        float completeness;
+        long key;
+    };
+
+    std::vector<Candidate> candidates_;
+    int n_total_;
+    bool finalised_;
+    KeyMode key_mode_;
+
+    std::vector<int> n_hits_;
+    std::vector<float> purity_;
+    std::vector<float> completeness_;
+    std::vector<long> keys_;
+    std::vector<double> purity_suffix_;
+    std::vector<double> completeness_suffix_;
+
+    // Queries read the sorted arrays, which are stale or empty until finalise()
+    void check_finalised() const
+    {
+        if (!finalised_)
+            throw std::logic_error("ThresholdScan: finalise() must be called after the last add_candidate()");
+    }
+};
+
+#endif // THRESHOLDSCAN_H
@@ -0,0 +1,9 @@
+#include "AnalysisServer.h"
+
+#include <iostream>
+#include <string>
+
+void analysis_client(const std::string& request = "stats", const std::string& socket_path = "/tmp/strangeness_analysis.sock")
+{
+    std::cout << AnalysisServer::send(socket_path, request) << std::endl;
+}
@@ -0,0 +1,16 @@
+#include "AnalysisServer.h"
+
+#include <iostream>
+#include <string>
+
+// Start once and leave running; query it with analysis_client.c, e.g.
+//   root -l -b -q 'analysis_client.c("histogram nu_e 50 0 5 mc_has_muon==1")'
+void analysis_server(const std::string& input_name = "prod_strange_resample_fhc_run2_fhc_reco2_reco2_signalfilter_1000_analysis.root",
+                     const std::string& socket_path = "/tmp/strangeness_analysis.sock", double cache_budget_mb = 1024)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/" + input_name;
+
+    AnalysisServer server(input_file, size_t(cache_budget_mb * 1024 * 1024));
+    server.serve(socket_path);
+}
@@ -0,0 +1,37 @@
+#include "AnalysisEvent.h"
+#include "EventAssembler.h"
+#include "AnalysisTrain.h"
+
+#include "muon_analyser.c"
+#include "pion_analyser.c"
+#include "purity_completeness_analyser.c"
+#include "reco_effic_analyser.c"
+#include "reco_event_effic.c"
+
+#include <iostream>
+#include <string>
+
+// All converted analysers in one read pass over the input. Each module
+// fills its own histograms, so with n_threads > 1 they run side by side.
+void analysis_train(const std::string& input_name = "prod_strange_resample_fhc_run2_fhc_reco2_reco2_signalfilter_1000_analysis.root",
+                    int n_threads = 4)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/" + input_name;
+
+    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
+
+    MuonAnalysis muon_analysis;
+    PionAnalysis pion_analysis;
+    PurityCompletenessAnalysis purity_completeness_analysis;
+    RecoEfficAnalysis reco_effic_analysis;
+    RecoEventEfficAnalysis reco_event_effic_analysis(input_file);
+
+    AnalysisTrain train(n_threads);
+    train.add(muon_analysis);
+    train.add(pion_analysis);
+    train.add(purity_completeness_analysis);
+    train.add(reco_effic_analysis);
+    train.add(reco_event_effic_analysis);
+    train.run(event_assembler);
+}
@@ -33,9 +33,9 @@ void backtrack_analyser()
             event_assembler.print_event(i);
             display_assembler.plot_event(i);
 
-            auto bt_pdg = *(event.bt_pdg); 
-            auto bt_tids = *(event.bt_tids);
-            auto bt_energy = *(event.bt_energy);
+            const auto& bt_pdg = *(event.bt_pdg); 
+            const auto& bt_tids = *(event.bt_tids);
+            const auto& bt_energy = *(event.bt_energy);
 
             std::cout << "Backtrack values:" << std::endl;
             for (size_t j = 0; j < bt_pdg.size(); ++j) {
@@ -0,0 +1,26 @@
+#include "AnalysisEvent.h"
+#include "EventAssembler.h"
+#include "DisplayQueue.h"
+
+#include <string>
+
+// Hand-scan thumbnails of signal events: one montage each for true and
+// reconstructed hits, plus full-size PNGs per event
+void display_thumbnails(int max_events = 200, int n_workers = 4)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
+
+    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
+    DisplayQueue display_queue(input_file, max_events);
+
+    // Signal entries come from the ingest-time topology column, without reading events
+    for (int i : event_assembler.select_events(kTopoMuon | kTopoKShortPionic)) {
+        if (display_queue.is_full()) break;
+        display_queue.add(i);
+    }
+
+    display_queue.render_montage("./plots/true_hits_montage.png", DisplayAssembler::kTrueHits);
+    display_queue.render_montage("./plots/reco_hits_montage.png", DisplayAssembler::kRecoHits);
+    display_queue.render(n_workers, DisplayQueue::kPng);
+}
@@ -0,0 +1,29 @@
+#include "AnalysisEvent.h"
+#include "EventAssembler.h"
+#include "HitImageExporter.h"
+
+#include <string>
+
+// Vertex-cropped hit images of every event with a reconstructed vertex,
+// labelled with category and truth topology, for K0S image tagging
+void export_hit_images(const std::string& output_prefix = "./plots/hit_images", int n_workers = 8)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
+
+    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
+    HitImageExporter exporter(input_file);
+
+    // The labels need only the event ids and PFP count; category and topology
+    // are ingest-time columns, so the selection pass reads four branches
+    event_assembler.set_branch_projection({ "run", "sub", "evt", "n_pfps" });
+    int num_events = event_assembler.get_num_events();
+    for (int i = 0; i < num_events; ++i) {
+        const AnalysisEvent& event = event_assembler.get_event(i);
+        if (event.n_pf_particles == 0) continue;
+        exporter.add(i, event);
+    }
+    event_assembler.set_branch_projection({});
+
+    exporter.write(output_prefix, n_workers);
+}
@@ -0,0 +1,38 @@
+#include "CompressedTable.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include <iostream>
+#include <string>
+#include <map>
+
+// Load the event tree into compressed columns and print the encoding
+// chosen for each branch. Positions are kept to 0.1 mm.
+void inspect_compressed_table(double position_precision = 0.01)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/prod_strange_resample_fhc_run2_fhc_reco2_reco2_signalfilter_1000_analysis.root";
+
+    TFile* file = TFile::Open(input_file.c_str(), "READ");
+    TTree* tree = dynamic_cast<TTree*>(file->Get("emptyselectionfilter/StrangenessSelectionFilter"));
+
+    std::map<std::string, double> fixed_point;
+    for (const char* branch : {"true_nu_vtx_x", "true_nu_vtx_y", "true_nu_vtx_z",
+                               "reco_nu_vtx_sce_x", "reco_nu_vtx_sce_y", "reco_nu_vtx_sce_z",
+                               "mc_muon_startx", "mc_muon_starty", "mc_muon_startz",
+                               "mc_muon_endx", "mc_muon_endy", "mc_muon_endz",
+                               "mc_kaon_decay_x", "mc_kaon_decay_y", "mc_kaon_decay_z",
+                               "mc_kshrt_piplus_startx", "mc_kshrt_piplus_starty", "mc_kshrt_piplus_startz",
+                               "mc_kshrt_piplus_endx", "mc_kshrt_piplus_endy", "mc_kshrt_piplus_endz",
+                               "mc_kshrt_piminus_startx", "mc_kshrt_piminus_starty", "mc_kshrt_piminus_startz",
+                               "mc_kshrt_piminus_endx", "mc_kshrt_piminus_endy", "mc_kshrt_piminus_endz"})
+    {
+        fixed_point[branch] = position_precision;
+    }
+
+    CompressedTable table(*tree, fixed_point);
+    table.print_summary();
+
+    file->Close();
+    delete file;
+}
@@ -0,0 +1,29 @@
+#include "AnalysisEvent.h"
+#include "EventAssembler.h"
+#include "OccupancyMap.h"
+
+#include <string>
+
+// Hit occupancy of every plane over the whole sample, and over signal
+// events alone to show where the K0S daughter pions deposit
+void occupancy_analyser(int n_threads = 8)
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
+
+    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
+    OccupancyAccumulator all_events(input_file);
+    OccupancyAccumulator signal_events(input_file);
+
+    // Signal entries come from the ingest-time topology column, so no event is
+    // read here; the accumulators read only the hit branches themselves
+    int num_events = event_assembler.get_num_events();
+    for (int i = 0; i < num_events; ++i) all_events.add(i);
+    for (int i : event_assembler.select_events(kTopoMuon | kTopoKShortPionic)) signal_events.add(i);
+
+    all_events.accumulate(n_threads);
+    signal_events.accumulate(n_threads);
+
+    all_events.write("./plots/occupancy_all.root");
+    signal_events.write("./plots/occupancy_signal.root");
+}
@@ -1,8 +1,8 @@
 #include "AnalysisEvent.h"
 #include "EventAssembler.h"
-#include "SliceAssembler.h"
+#include "AnalysisTrain.h"
 #include "PlotFunctions.h"
-#include "DisplayAssembler.h"
+#include "HistogramAccumulator.h"
 
 #include "TH2D.h"
 #include "TGraphErrors.h"
@@ -14,74 +14,106 @@
 #include <cmath>
 #include <random>
 
+class PionAnalysis : public AnalysisModule
+{
+public:
+    PionAnalysis()
+        : piplus_purity_completeness(Binning::uniform(20, 0, 1), Binning::uniform(20, 0, 1)),
+          piminus_purity_completeness(Binning::uniform(20, 0, 1), Binning::uniform(20, 0, 1)),
+          muon_purity_completeness(Binning::uniform(20, 0, 1), Binning::uniform(20, 0, 1)) {}
+
+    std::string get_name() const override { return "pion_analyser"; }
+
+    std::vector<std::string> get_required_branches() const override
+    {
+        return {"mc_has_muon", "mc_is_kshort_decay_pionic",
+                "pfp_piplus_purity", "pfp_piplus_completeness", "pfp_piminus_purity",
+                "pfp_piminus_completeness", "pfp_muon_purity", "pfp_muon_completeness"};
+    }
+
+    bool is_independent() const override { return true; }
+
+    void begin() override
+    {
+        total_piplus = 0;
+        total_piminus = 0;
+        total_muons = 0;
+        piplus_purity_completeness.reset();
+        piminus_purity_completeness.reset();
+        muon_purity_completeness.reset();
+    }
+
+    void process(int entry, const AnalysisEvent& event) override
+    {
+        if (!event.mc_has_muon) return;
+        if (!event.mc_is_kshort_decay_pionic) return;
+
+        // Every PFP in one batch update per particle
+        size_t n_piplus = std::min(event.pfp_piplus_purity->size(), event.pfp_piplus_completeness->size());
+        piplus_purity_completeness.fill_n(n_piplus, event.pfp_piplus_purity->data(), event.pfp_piplus_completeness->data());
+        total_piplus += n_piplus;
+
+        size_t n_piminus = std::min(event.pfp_piminus_purity->size(), event.pfp_piminus_completeness->size());
+        piminus_purity_completeness.fill_n(n_piminus, event.pfp_piminus_purity->data(), event.pfp_piminus_completeness->data());
+        total_piminus += n_piminus;
+
+        size_t n_muon = std::min(event.pfp_muon_purity->size(), event.pfp_muon_completeness->size());
+        muon_purity_completeness.fill_n(n_muon, event.pfp_muon_purity->data(), event.pfp_muon_completeness->data());
+        total_muons += n_muon;
+    }
+
+    void end() override
+    {
+        TH2D* h2_piplus_purity_completeness = piplus_purity_completeness.to_th2d("h2_pion_piplus_purity_completeness", "");
+        TH2D* h2_piminus_purity_completeness = piminus_purity_completeness.to_th2d("h2_pion_piminus_purity_completeness", "");
+        TH2D* h2_muon_purity_completeness = muon_purity_completeness.to_th2d("h2_pion_muon_purity_completeness", "");
+
+        TCanvas* c_piplus_purity_completeness = new TCanvas("c_piplus_purity_completeness", "Pi+ Purity vs Completeness", 800, 600);
+        h2_piplus_purity_completeness->GetXaxis()->SetTitle("True Pi+ Purity");
+        h2_piplus_purity_completeness->GetYaxis()->SetTitle("True Pi+ Completeness");
+        h2_piplus_purity_completeness->Draw("COLZ");
+        c_piplus_purity_completeness->SaveAs("./plots/piplus_purity_completeness.pdf");
+
+        TCanvas* c_piminus_purity_completeness = new TCanvas("c_piminus_purity_completeness", "Pi- Purity vs Completeness", 800, 600);
+        h2_piminus_purity_completeness->GetXaxis()->SetTitle("True Pi- Purity");
+        h2_piminus_purity_completeness->GetYaxis()->SetTitle("True Pi- Completeness");
+        h2_piminus_purity_completeness->Draw("COLZ");
+        c_piminus_purity_completeness->SaveAs("./plots/piminus_purity_completeness.pdf");
+
+        TCanvas* c_muon_purity_completeness = new TCanvas("c_muon_purity_completeness", "Muon Purity vs Completeness", 800, 600);
+        h2_muon_purity_completeness->GetXaxis()->SetTitle("True Muon Purity");
+        h2_muon_purity_completeness->GetYaxis()->SetTitle("True Muon Completeness");
+        h2_muon_purity_completeness->Draw("COLZ");
+        c_muon_purity_completeness->SaveAs("./plots/muon_purity_completeness.pdf");
+
+        delete c_piplus_purity_completeness;
+        delete h2_piplus_purity_completeness;
+        delete c_piminus_purity_completeness;
+        delete h2_piminus_purity_completeness;
+        delete c_muon_purity_completeness;
+        delete h2_muon_purity_completeness;
+
+        std::cout << "Total number of pi+ analysed: " << total_piplus << std::endl;
+        std::cout << "Total number of pi- analysed: " << total_piminus << std::endl;
+        std::cout << "Total number of muons analysed: " << total_muons << std::endl;
+    }
+
+private:
+    int total_piplus, total_piminus, total_muons;
+    Histogram2D piplus_purity_completeness;
+    Histogram2D piminus_purity_completeness;
+    Histogram2D muon_purity_completeness;
+};
+
 void pion_analyser() 
 {
     const char* data_dir = getenv("DATA_DIR");
     std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
 
     const EventAssembler& event_assembler = EventAssembler::instance(input_file);
-    const DisplayAssembler& display_assembler = DisplayAssembler::instance(input_file);
-
-    int num_events = event_assembler.get_num_events();
-    int total_piplus = 0, total_piminus = 0, total_muons = 0;
-
-    TH2D *h2_piplus_purity_completeness = new TH2D("h2_piplus_purity_completeness", "", 20, 0, 1, 20, 0, 1);
-    TH2D *h2_piminus_purity_completeness = new TH2D("h2_piminus_purity_completeness", "", 20, 0, 1, 20, 0, 1);
-    TH2D *h2_muon_purity_completeness = new TH2D("h2_muon_purity_completeness", "", 20, 0, 1, 20, 0, 1);
-
-    for (int i = 0; i < num_events; ++i) {
-        const AnalysisEvent& event = event_assembler.get_event(i);
-        if (!event.mc_has_muon) continue;
-        if (!event.mc_is_kshort_decay_pionic) continue;
-
-        for (size_t j = 0; j < event.pfp_piplus_purity->size(); ++j) {
-            float piplus_purity = event.pfp_piplus_purity->at(j);
-            float piplus_completeness = event.pfp_piplus_completeness->at(j);
-            h2_piplus_purity_completeness->Fill(piplus_purity, piplus_completeness);
-            total_piplus++;
-        }
-
-        for (size_t j = 0; j < event.pfp_piminus_purity->size(); ++j) {
-            float piminus_purity = event.pfp_piminus_purity->at(j);
-            float piminus_completeness = event.pfp_piminus_completeness->at(j);
-            h2_piminus_purity_completeness->Fill(piminus_purity, piminus_completeness);
-            total_piminus++;
-        }
-
-        for (size_t j = 0; j < event.pfp_muon_purity->size(); ++j) {
-            float muon_purity = event.pfp_muon_purity->at(j);
-            float muon_completeness = event.pfp_muon_completeness->at(j);
-            h2_muon_purity_completeness->Fill(muon_purity, muon_completeness);
-            total_muons++;
-        }
-    }
 
-    TCanvas* c_piplus_purity_completeness = new TCanvas("c_piplus_purity_completeness", "Pi+ Purity vs Completeness", 800, 600);
-    h2_piplus_purity_completeness->GetXaxis()->SetTitle("True Pi+ Purity");
-    h2_piplus_purity_completeness->GetYaxis()->SetTitle("True Pi+ Completeness");
-    h2_piplus_purity_completeness->Draw("COLZ");
-    c_piplus_purity_completeness->SaveAs("./plots/piplus_purity_completeness.pdf");
-
-    TCanvas* c_piminus_purity_completeness = new TCanvas("c_piminus_purity_completeness", "Pi- Purity vs Completeness", 800, 600);
-    h2_piminus_purity_completeness->GetXaxis()->SetTitle("True Pi- Purity");
-    h2_piminus_purity_completeness->GetYaxis()->SetTitle("True Pi- Completeness");
-    h2_piminus_purity_completeness->Draw("COLZ");
-    c_piminus_purity_completeness->SaveAs("./plots/piminus_purity_completeness.pdf");
-
-    TCanvas* c_muon_purity_completeness = new TCanvas("c_muon_purity_completeness", "Muon Purity vs Completeness", 800, 600);
-    h2_muon_purity_completeness->GetXaxis()->SetTitle("True Muon Purity");
-    h2_muon_purity_completeness->GetYaxis()->SetTitle("True Muon Completeness");
-    h2_muon_purity_completeness->Draw("COLZ");
-    c_muon_purity_completeness->SaveAs("./plots/muon_purity_completeness.pdf");
-
-    delete c_piplus_purity_completeness;
-    delete h2_piplus_purity_completeness;
-    delete c_piminus_purity_completeness;
-    delete h2_piminus_purity_completeness;
-    delete c_muon_purity_completeness;
-    delete h2_muon_purity_completeness;
-
-    std::cout << "Total number of pi+ analysed: " << total_piplus << std::endl;
-    std::cout << "Total number of pi- analysed: " << total_piminus << std::endl;
-    std::cout << "Total number of muons analysed: " << total_muons << std::endl;
-}
\ No newline at end of file
+    PionAnalysis pion_analysis;
+    AnalysisTrain train;
+    train.add(pion_analysis);
+    train.run(event_assembler);
+}
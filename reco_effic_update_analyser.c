@@ -3,6 +3,7 @@
 #include "SliceAssembler.h"
 #include "PlotFunctions.h"
 #include "DisplayAssembler.h"
+#include "EfficiencyEngine.h"
 
 #include "TH1D.h"
 #include "TCanvas.h"
@@ -84,182 +85,91 @@ void reco_effic_update_analyser()
     const EventAssembler& event_assembler = EventAssembler::instance(input_file);
     int num_events = event_assembler.get_num_events();
 
-    int n_bins = 8;
-    double x_min = 0.1;  
-    double x_max = 3.14;
-
-    // Efficiency objects for true energy and momentum
-    TEfficiency* mu_effic = new TEfficiency("mu_effic", "Muon Efficiency;True Particle Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piplus_effic = new TEfficiency("piplus_effic", "Pion-Plus Efficiency;True Particle Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piminus_effic = new TEfficiency("piminus_effic", "Pion-Minus Efficiency;True Particle Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-
-    TEfficiency* mu_mom_effic = new TEfficiency("mu_mom_effic", "Muon Efficiency;True Particle Momentum [GeV/c]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piplus_mom_effic = new TEfficiency("piplus_mom_effic", "Pion-Plus Efficiency;True Particle Momentum [GeV/c]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piminus_mom_effic = new TEfficiency("piminus_mom_effic", "Pion-Minus Efficiency;True Particle Momentum [GeV/c]; Recognition Efficiency", n_bins, x_min, x_max);
-
-    TEfficiency* mu_mom_kshrt_energy = new TEfficiency("mu_mom_effic", "Muon Efficiency;True Kaon-Short Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piplus_mom_kshrt_energy = new TEfficiency("piplus_mom_effic", "Pion-Plus Efficiency;True Kaon-Short Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-    TEfficiency* piminus_mom_kshrt_energy = new TEfficiency("piminus_mom_effic", "Pion-Minus Efficiency;True Kaon-Short Energy [GeV]; Recognition Efficiency", n_bins, x_min, x_max);
-
-    int n_bins_sep = 100;
-    double x_min_sep = 0.1;
-    double x_max_sep = 100;
-
-    TEfficiency* mu_mom_kshrt_sep = new TEfficiency("mu_mom_effic", "Muon Efficiency;True Kaon-Short Decay Distance []; Recognition Efficiency", n_bins_sep, x_min_sep, x_max_sep);
-    TEfficiency* piplus_mom_kshrt_sep = new TEfficiency("piplus_mom_effic", "Pion-Plus Efficiency;True Kaon-Short Decay Distance []; Recognition Efficiency", n_bins_sep, x_min_sep, x_max_sep);
-    TEfficiency* piminus_mom_kshrt_sep = new TEfficiency("piminus_mom_effic", "Pion-Minus Efficiency;True Kaon-Short Decay Distance []; Recognition Efficiency", n_bins_sep, x_min_sep, x_max_sep);
-
-    int n_bins_ang = 8;
-    double x_min_ang = 0; 
-    double x_max_ang = 3.14;
-
-    TEfficiency* mu_mom_open_angle = new TEfficiency("mu_mom_effic", "Muon Efficiency;True Decay Opening Angle [rad]; Recognition Efficiency", n_bins_ang, x_min_ang, x_max_ang);
-    TEfficiency* piplus_mom_open_angle = new TEfficiency("piplus_mom_effic", "Pion-Plus Efficiency;True Decay Opening Angle [rad]; Recognition Efficiency", n_bins_ang, x_min_ang, x_max_ang);
-    TEfficiency* piminus_mom_open_angle = new TEfficiency("piminus_mom_effic", "Pion-Minus Efficiency;True Decay Opening Angle [rad]; Recognition Efficiency", n_bins_ang, x_min_ang, x_max_ang);
-
-    /*int n_bins_w = 10;
-    double x_min_w = 0; 
-    double x_max_w = -1;
-
-    TEfficiency* mu_w = new TEfficiency("", ";True Event Invariant Mass [GeV]; Recognition Efficiency", n_bins_w, x_min_w, x_max_w);
-    TEfficiency* piplus_w = new TEfficiency("", ";True Event Invariant Mass [GeV]; Recognition Efficiency", n_bins_w, x_min_w, x_max_w);
-    TEfficiency* piminus_w = new TEfficiency("", ";True Event Invariant Mass [GeV]; Recognition Efficiency", n_bins_w, x_min_w, x_max_w);*/
-
-    int mu_filled = 0, piplus_filled = 0, piminus_filled = 0, kshort_filled = 0;
+    EfficiencyEngine engine;
+
+    // Truth denominators and reconstruction numerators for each particle
+    int mu_true = engine.define_selection("mu_true", [](const AnalysisEvent& e) {
+        return e.mc_has_muon && e.mc_is_kshort_decay_pionic && e.mc_muon_tid;
+    });
+    int piplus_true = engine.define_selection("piplus_true", [](const AnalysisEvent& e) {
+        return e.mc_has_muon && e.mc_is_kshort_decay_pionic && e.mc_kshrt_piplus_tid;
+    });
+    int piminus_true = engine.define_selection("piminus_true", [](const AnalysisEvent& e) {
+        return e.mc_has_muon && e.mc_is_kshort_decay_pionic && e.mc_kshrt_piminus_tid;
+    });
+
+    int mu_reco = engine.define_selection("mu_reco", [](const AnalysisEvent& e) {
+        return e.match_index.get_first_match(MatchIndex::kMuon) != BOGUS_INDEX;
+    });
+    int piplus_reco = engine.define_selection("piplus_reco", [](const AnalysisEvent& e) {
+        return e.match_index.get_first_match(MatchIndex::kPiPlus) != BOGUS_INDEX;
+    });
+    int piminus_reco = engine.define_selection("piminus_reco", [](const AnalysisEvent& e) {
+        return e.match_index.get_first_match(MatchIndex::kPiMinus) != BOGUS_INDEX;
+    });
+
+    struct Particle 
+    {
+        std::string name;
+        std::string label;
+        int reco;
+        int truth;
+        EfficiencyEngine::Variable energy;
+        EfficiencyEngine::Variable momentum;
+    };
+
+    std::vector<Particle> particles = {
+        { "mu", "Muon", mu_reco, mu_true,
+          [](const AnalysisEvent& e) { return e.mc_muon_energy; },
+          [](const AnalysisEvent& e) { return e.derived[kMuonMomentum]; } },
+        { "piplus", "Pion-Plus", piplus_reco, piplus_true,
+          [](const AnalysisEvent& e) { return e.mc_kshrt_piplus_energy; },
+          [](const AnalysisEvent& e) { return e.derived[kPiPlusMomentum]; } },
+        { "piminus", "Pion-Minus", piminus_reco, piminus_true,
+          [](const AnalysisEvent& e) { return e.mc_kshrt_piminus_energy; },
+          [](const AnalysisEvent& e) { return e.derived[kPiMinusMomentum]; } }
+    };
+
+    EfficiencyEngine::Variable kshrt_energy = [](const AnalysisEvent& e) { return e.mc_kshrt_total_energy; };
+    EfficiencyEngine::Variable kshrt_sep = [](const AnalysisEvent& e) { return e.mc_kshrt_end_sep; };
+    EfficiencyEngine::Variable open_angle = [](const AnalysisEvent& e) { return e.derived[kPiPiOpeningAngle]; };
+
+    for (const Particle& p : particles) {
+        std::string prefix = p.label + " Efficiency;";
+        engine.add_curve(p.name + "_energy", prefix + "True Particle Energy [GeV]; Recognition Efficiency", 8, 0.1, 3.14, p.energy, p.reco, p.truth);
+        engine.add_curve(p.name + "_momentum", prefix + "True Particle Momentum [GeV/c]; Recognition Efficiency", 8, 0.1, 3.14, p.momentum, p.reco, p.truth);
+        engine.add_curve(p.name + "_kshrt_energy", prefix + "True Kaon-Short Energy [GeV]; Recognition Efficiency", 8, 0.1, 3.14, kshrt_energy, p.reco, p.truth);
+        engine.add_curve(p.name + "_kshrt_sep", prefix + "True Kaon-Short Decay Distance []; Recognition Efficiency", 100, 0.1, 100, kshrt_sep, p.reco, p.truth);
+        engine.add_curve(p.name + "_open_angle", prefix + "True Decay Opening Angle [rad]; Recognition Efficiency", 8, 0, 3.14, open_angle, p.reco, p.truth);
+    }
 
     // Loop over events and fill efficiencies
     for (int i = 0; i < num_events; ++i) {
-        const AnalysisEvent& event = event_assembler.get_event(i);
-        if (!event.mc_has_muon) continue;
-        if (!event.mc_is_kshort_decay_pionic) continue;
-
-        float kshrt_energy = event.mc_kshrt_total_energy;
-        float kshrt_sep = event.mc_kshrt_end_sep;
-
-        TVector3 piplus_vec(event.mc_kshrt_piplus_px, event.mc_kshrt_piplus_py, event.mc_kshrt_piplus_pz);
-        TVector3 piminus_vec(event.mc_kshrt_piminus_px, event.mc_kshrt_piminus_py, event.mc_kshrt_piminus_pz);
-        float angle_deg = piplus_vec.Angle(piminus_vec); 
-
-        // Muon reconstruction analysis
-        if (event.mc_muon_tid) {
-            float energy = event.mc_muon_energy;
-            float momentum = std::sqrt(event.mc_muon_px * event.mc_muon_px +
-                                       event.mc_muon_py * event.mc_muon_py +
-                                       event.mc_muon_pz * event.mc_muon_pz);
-            bool found_candidate = false;
-            if (event.pfp_muon_purity && event.pfp_muon_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_muon_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_muon_purity->at(pfp_idx);
-                    float completeness = event.pfp_muon_completeness->at(pfp_idx);
-
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        mu_effic->Fill(true, energy);
-                        mu_mom_effic->Fill(true, momentum);
-                        mu_mom_kshrt_energy->Fill(true, kshrt_energy);
-                        mu_mom_kshrt_sep->Fill(true, kshrt_sep);
-                        mu_mom_open_angle->Fill(true, angle_deg);
-                        mu_filled++;
-                        found_candidate = true;
-                        break;
-                    }
-                }
-            }
-            if (!found_candidate) {
-                mu_effic->Fill(false, energy);
-                mu_mom_effic->Fill(false, momentum);
-                mu_mom_kshrt_energy->Fill(false, kshrt_energy);
-                mu_mom_kshrt_sep->Fill(false, kshrt_sep);
-                mu_mom_open_angle->Fill(false, angle_deg);
-            }
-        }
-
-        // Pion-plus reconstruction analysis
-        if (event.mc_kshrt_piplus_tid) {
-            float energy = event.mc_kshrt_piplus_energy;
-            float momentum = std::sqrt(event.mc_kshrt_piplus_px * event.mc_kshrt_piplus_px +
-                                       event.mc_kshrt_piplus_py * event.mc_kshrt_piplus_py +
-                                       event.mc_kshrt_piplus_pz * event.mc_kshrt_piplus_pz);
-            bool found_candidate = false;
-
-            if (event.pfp_piplus_purity && event.pfp_piplus_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_piplus_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_piplus_purity->at(pfp_idx);
-                    float completeness = event.pfp_piplus_completeness->at(pfp_idx);
-
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        piplus_effic->Fill(true, energy);
-                        piplus_mom_effic->Fill(true, momentum);
-                        piplus_mom_kshrt_energy->Fill(true, kshrt_energy);
-                        piplus_mom_kshrt_sep->Fill(true, kshrt_sep);
-                        piplus_mom_open_angle->Fill(true, angle_deg);
-                        piplus_filled++;
-                        found_candidate = true;
-                        break;
-                    }
-                }
-            }
-            if (!found_candidate) {
-                piplus_effic->Fill(false, energy);
-                piplus_mom_effic->Fill(false, momentum);
-                piplus_mom_kshrt_energy->Fill(false, kshrt_energy);
-                piplus_mom_kshrt_sep->Fill(false, kshrt_sep);
-                piplus_mom_open_angle->Fill(false, angle_deg);
-            }
-        }
-
-        // Pion-minus reconstruction analysis
-        if (event.mc_kshrt_piminus_tid) {
-            float energy = event.mc_kshrt_piminus_energy;
-            float momentum = std::sqrt(event.mc_kshrt_piplus_px * event.mc_kshrt_piplus_px +
-                                       event.mc_kshrt_piplus_py * event.mc_kshrt_piplus_py +
-                                       event.mc_kshrt_piplus_pz * event.mc_kshrt_piplus_pz);
-            bool found_candidate = false;
-            if (event.pfp_piminus_purity && event.pfp_piminus_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_piminus_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_piminus_purity->at(pfp_idx);
-                    float completeness = event.pfp_piminus_completeness->at(pfp_idx);
-
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        piminus_effic->Fill(true, energy);
-                        piminus_mom_effic->Fill(true, momentum);
-                        piminus_mom_kshrt_energy->Fill(true, kshrt_energy);
-                        piminus_mom_kshrt_sep->Fill(true, kshrt_sep);
-                        piminus_mom_open_angle->Fill(true, angle_deg);
-                        piminus_filled++;
-                        found_candidate = true;
-                        break;
-                    }
-                }
-            }
-            if (!found_candidate) {
-                piminus_effic->Fill(false, energy);
-                piminus_mom_effic->Fill(false, momentum);
-                piminus_mom_kshrt_energy->Fill(false, kshrt_energy);
-                piminus_mom_kshrt_sep->Fill(false, kshrt_sep);
-                piminus_mom_open_angle->Fill(false, angle_deg);
-            }
-        }
+        engine.fill(event_assembler.get_event(i));
     }
 
     // Debugging: Print out how many entries were filled
-    std::cout << "Muon entries filled: " << mu_filled << std::endl;
-    std::cout << "Pion-plus entries filled: " << piplus_filled << std::endl;
-    std::cout << "Pion-minus entries filled: " << piminus_filled << std::endl;
-    std::cout << "Kaon-short entries filled: " << kshort_filled << std::endl;
+    std::cout << "Muon entries filled: " << engine.get_num_passed("mu_energy") << std::endl;
+    std::cout << "Pion-plus entries filled: " << engine.get_num_passed("piplus_energy") << std::endl;
+    std::cout << "Pion-minus entries filled: " << engine.get_num_passed("piminus_energy") << std::endl;
 
-    // Call the plotting function with appropriate axis label, output file name, and dynamic x-axis range
-    plot_efficiency(mu_effic, piplus_effic, piminus_effic, "True Energy [GeV]", "EfficiencyPlot_full.pdf", 0.1, 3.0);
-    plot_efficiency(mu_mom_effic, piplus_mom_effic, piminus_mom_effic, "True Momentum [GeV/c]", "MomentumEfficiencyPlot.pdf", 0.1, 3.0);
+    // Overlay the three particles for each variable
+    auto plot_variable = [&](const std::string& variable, const char* x_axis_label, const char* output_filename, double x_min, double x_max) {
+        TEfficiency* mu_effic = engine.make_efficiency("mu_" + variable);
+        TEfficiency* piplus_effic = engine.make_efficiency("piplus_" + variable);
+        TEfficiency* piminus_effic = engine.make_efficiency("piminus_" + variable);
 
-    plot_efficiency(mu_mom_kshrt_energy, piplus_mom_kshrt_energy, piminus_mom_kshrt_energy, "True Kaon-Short Energy [GeV]", "KaonShortEnergyEfficiencyPlot.pdf", 0.1, 3.0);
-    plot_efficiency(mu_mom_kshrt_sep, piplus_mom_kshrt_sep, piminus_mom_kshrt_sep, "True Kaon-Short Decay Distance []", "KaonShortDecayDistanceEfficiencyPlot.pdf", 0.01, 20.0);
-    plot_efficiency(mu_mom_open_angle, piplus_mom_open_angle, piminus_mom_open_angle, "True Decay Opening Angle []", "KaonShortOpeningAngleEfficiencyPlot.pdf", 0., 3.14);
+        plot_efficiency(mu_effic, piplus_effic, piminus_effic, x_axis_label, output_filename, x_min, x_max);
 
-    // Cleanup
-    delete mu_effic;
-    delete piplus_effic;
-    delete piminus_effic;
-    delete mu_mom_effic;
-    delete piplus_mom_effic;
-    delete piminus_mom_effic;
+        delete mu_effic;
+        delete piplus_effic;
+        delete piminus_effic;
+    };
+
+    plot_variable("energy", "True Energy [GeV]", "EfficiencyPlot_full.pdf", 0.1, 3.0);
+    plot_variable("momentum", "True Momentum [GeV/c]", "MomentumEfficiencyPlot.pdf", 0.1, 3.0);
+
+    plot_variable("kshrt_energy", "True Kaon-Short Energy [GeV]", "KaonShortEnergyEfficiencyPlot.pdf", 0.1, 3.0);
+    plot_variable("kshrt_sep", "True Kaon-Short Decay Distance []", "KaonShortDecayDistanceEfficiencyPlot.pdf", 0.01, 20.0);
+    plot_variable("open_angle", "True Decay Opening Angle []", "KaonShortOpeningAngleEfficiencyPlot.pdf", 0., 3.14);
 }
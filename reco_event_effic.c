@@ -1,8 +1,12 @@
 #include "AnalysisEvent.h"
 #include "EventAssembler.h"
+#include "AnalysisTrain.h"
 #include "SliceAssembler.h"
 #include "PlotFunctions.h"
-#include "DisplayAssembler.h"
+#include "DisplayQueue.h"
+#include "EfficiencyEngine.h"
+#include "EfficiencyMap.h"
+#include "HistogramCache.h"
 
 #include "TH1D.h"
 #include "TCanvas.h"
@@ -147,184 +151,195 @@ void plot_efficiency(TEfficiency* effic, std::string title, std::string name, do
     c->Close();
 }
 
-void reco_event_effic()
+bool is_well_reconstructed(const AnalysisEvent& event)
 {
-    const char* data_dir = getenv("DATA_DIR");
-    std::string input_file = std::string(data_dir) + "/prod_strange_resample_fhc_run2_fhc_reco2_reco2_signalfilter_1000_analysis.root";
+    if (!event.mc_muon_tid || !event.mc_kshrt_piplus_tid || !event.mc_kshrt_piminus_tid) 
+        return false;
 
-    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
-    const DisplayAssembler& display_assembler = DisplayAssembler::instance(input_file);
-    int num_events = event_assembler.get_num_events();
-
-    int n_bins = 15;
-    double x_min = 0.1;
-    double x_max = 3.0;
-
-    // Efficiency histograms for energy, separation, and opening angle
-    TEfficiency* event_effic_energy = new TEfficiency("event_effic_energy", ";True Kaon-Short Energy [GeV];Reconstruction Efficiency", n_bins, x_min, x_max);
-
-    double x_min_sep = 0;
-    double x_max_sep = 24;
-    int n_bins_sep = 24;
-    TEfficiency* event_effic_sep = new TEfficiency("event_effic_sep", ";True K_{S}^{0} Decay Distance [cm];Event Recognition Efficiency", n_bins_sep, x_min_sep, x_max_sep);
-
-    double x_min_ang = 0.0;
-    double x_max_ang = 3.14;
-    int n_bins_ang = 15;
-    TEfficiency* event_effic_angle = new TEfficiency("event_effic_angle", ";True Decay Opening Angle [rad];Reconstruction Efficiency", n_bins_ang, x_min_ang, x_max_ang);
-
-    // Momentum efficiency histograms for muon, pion-plus, and pion-minus
-    double x_min_momentum = 0.0;
-    double x_max_momentum = 3.0; // GeV/c (adjust this based on the range of momenta in your events)
-    TEfficiency* event_effic_muon_momentum = new TEfficiency("event_effic_muon_momentum", ";True Muon Momentum [GeV/c];Reconstruction Efficiency", n_bins, x_min_momentum, x_max_momentum);
-    TEfficiency* event_effic_piplus_momentum = new TEfficiency("event_effic_piplus_momentum", ";True Pion-Plus Momentum [GeV/c];Reconstruction Efficiency", n_bins, x_min_momentum, x_max_momentum);
-    TEfficiency* event_effic_piminus_momentum = new TEfficiency("event_effic_piminus_momentum", ";True Pion-Minus Momentum [GeV/c];Reconstruction Efficiency", n_bins, x_min_momentum, x_max_momentum);
-
-    TEfficiency* event_effic_W = new TEfficiency("", ";True W;Reconstruction Efficiency", 100, 0, 100);
-    TEfficiency* event_effic_X = new TEfficiency("", ";True X;Reconstruction Efficiency", 100, 0, 100);
-    TEfficiency* event_effic_Y = new TEfficiency("", ";True Y;Reconstruction Efficiency", 100, 0, 100);
-    TEfficiency* event_effic_QSqr = new TEfficiency("", ";True QSqr;Reconstruction Efficiency", 100, 0, 100);
-
-    TEfficiency* event_effic_nu_energy = new TEfficiency("", ";True Neutrino Energy;Reconstruction Efficiency", 24, 0, -1);
-
-    int well_reconstructed_filled = 0;
-    for (int i = 0; i < num_events; ++i) {
-        const AnalysisEvent& event = event_assembler.get_event(i);
-        if (!event.mc_is_kshort_decay_pionic) continue;
-        if (!event.mc_has_muon) continue;
-
-        float kshort_energy = event.mc_kshrt_total_energy;
-        float kshort_sep = event.mc_kshrt_end_sep;
-
-        // Calculate opening angle between pion-plus and pion-minus
-        TVector3 piplus_vec(event.mc_kshrt_piplus_px, event.mc_kshrt_piplus_py, event.mc_kshrt_piplus_pz);
-        TVector3 piminus_vec(event.mc_kshrt_piminus_px, event.mc_kshrt_piminus_py, event.mc_kshrt_piminus_pz);
-        float angle_rad = piplus_vec.Angle(piminus_vec);
-
-        // Calculate momenta for muon, pion-plus, and pion-minus
-        float muon_momentum = std::sqrt(event.mc_muon_px * event.mc_muon_px +
-                                        event.mc_muon_py * event.mc_muon_py +
-                                        event.mc_muon_pz * event.mc_muon_pz);
-        float piplus_momentum = piplus_vec.Mag();  // Magnitude of the pion-plus momentum vector
-        float piminus_momentum = piminus_vec.Mag(); // Magnitude of the pion-minus momentum vector
-
-        size_t muon_pf_index = -1;
-        size_t piplus_pf_index = -1;
-        size_t piminus_pf_index = -1;
-
-        bool muon_reco = false;
-        if (event.mc_muon_tid) {
-            if (event.pfp_muon_purity && event.pfp_muon_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_muon_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_muon_purity->at(pfp_idx);
-                    float completeness = event.pfp_muon_completeness->at(pfp_idx);
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        muon_reco = true;
-                        muon_pf_index = pfp_idx; 
-                        break;
-                    }
-                }
-            }
-        }
+    // Check if muon, pion-plus, and pion-minus are well reconstructed and independent
+    return event.match_index.has_distinct_first_matches();
+}
 
-        bool piplus_reco = false;
-        if (event.mc_kshrt_piplus_tid) {
-            if (event.pfp_piplus_purity && event.pfp_piplus_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_piplus_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_piplus_purity->at(pfp_idx);
-                    float completeness = event.pfp_piplus_completeness->at(pfp_idx);
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        piplus_reco = true;
-                        piplus_pf_index = pfp_idx; 
-                        break;
-                    }
-                }
-            }
-        }
+class RecoEventEfficAnalysis : public AnalysisModule
+{
+public:
+    RecoEventEfficAnalysis(const std::string& input_file)
+        : display_queue(input_file),
+          // Fine map over the truth variables, projected after the loop
+          efficiency_map({
+              { "kshort_energy", "True Kaon-Short Energy [GeV]", 30, 0.0, 3.0, [](const AnalysisEvent& e) { return e.mc_kshrt_total_energy; } },
+              { "kshort_sep", "True K_{S}^{0} Decay Distance [cm]", 48, 0, 24, [](const AnalysisEvent& e) { return e.mc_kshrt_end_sep; } },
+              { "opening_angle", "True Decay Opening Angle [rad]", 30, 0.0, 3.15, [](const AnalysisEvent& e) { return e.derived[kPiPiOpeningAngle]; } },
+              { "W", "True W [GeV]", 30, 0, 3, [](const AnalysisEvent& e) { return e.mc_nu_W; } },
+              { "QSqr", "True Q^{2} [GeV^{2}]", 30, 0, 3, [](const AnalysisEvent& e) { return e.mc_nu_QSqr; } }
+          })
+    {
+        signal = engine.define_selection("signal", [](const AnalysisEvent& e) {
+            return e.mc_is_kshort_decay_pionic && e.mc_has_muon;
+        });
+        well_reconstructed = engine.define_selection("well_reconstructed", is_well_reconstructed);
+
+        auto add_curve = [&](const std::string& name, const std::string& axis_title, int n_bins, double x_min, double x_max, EfficiencyEngine::Variable variable) {
+            engine.add_curve(name, ";" + axis_title + ";Reconstruction Efficiency", n_bins, x_min, x_max, variable, well_reconstructed, signal);
+        };
+
+        add_curve("kshort_energy", "True Kaon-Short Energy [GeV]", 15, 0.1, 3.0, [](const AnalysisEvent& e) { return e.mc_kshrt_total_energy; });
+        add_curve("kshort_sep", "True K_{S}^{0} Decay Distance [cm]", 24, 0, 24, [](const AnalysisEvent& e) { return e.mc_kshrt_end_sep; });
+        add_curve("opening_angle", "True Decay Opening Angle [rad]", 15, 0.0, 3.14, [](const AnalysisEvent& e) { return e.derived[kPiPiOpeningAngle]; });
+
+        add_curve("muon_momentum", "True Muon Momentum [GeV/c]", 15, 0.0, 3.0, [](const AnalysisEvent& e) { return e.derived[kMuonMomentum]; });
+        add_curve("piplus_momentum", "True Pion-Plus Momentum [GeV/c]", 15, 0.0, 3.0, [](const AnalysisEvent& e) { return e.derived[kPiPlusMomentum]; });
+        add_curve("piminus_momentum", "True Pion-Minus Momentum [GeV/c]", 15, 0.0, 3.0, [](const AnalysisEvent& e) { return e.derived[kPiMinusMomentum]; });
+
+        add_curve("W", "True W", 100, 0, 100, [](const AnalysisEvent& e) { return e.mc_nu_W; });
+        add_curve("X", "True X", 100, 0, 100, [](const AnalysisEvent& e) { return e.mc_nu_X; });
+        add_curve("Y", "True Y", 100, 0, 100, [](const AnalysisEvent& e) { return e.mc_nu_Y; });
+        add_curve("Qsqr", "True QSqr", 100, 0, 100, [](const AnalysisEvent& e) { return e.mc_nu_QSqr; });
+
+        add_curve("energy", "True Neutrino Energy [GeV]", 24, 0, 6, [](const AnalysisEvent& e) { return e.mc_nu_energy; });
+
+        // Fine-binned efficiencies persisted for reco_event_effic_replot()
+        cached_variables = {
+            { cache.book_efficiency("kshort_energy", ";True Kaon-Short Energy [GeV];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.mc_kshrt_total_energy; } },
+            { cache.book_efficiency("kshort_sep", ";True K_{S}^{0} Decay Distance [cm];Events/bin", 500, 0, 50), [](const AnalysisEvent& e) { return e.mc_kshrt_end_sep; } },
+            { cache.book_efficiency("opening_angle", ";True Decay Opening Angle [rad];Events/bin", 315, 0, 3.15), [](const AnalysisEvent& e) { return e.derived[kPiPiOpeningAngle]; } },
+            { cache.book_efficiency("muon_momentum", ";True Muon Momentum [GeV/c];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.derived[kMuonMomentum]; } },
+            { cache.book_efficiency("piplus_momentum", ";True Pion-Plus Momentum [GeV/c];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.derived[kPiPlusMomentum]; } },
+            { cache.book_efficiency("piminus_momentum", ";True Pion-Minus Momentum [GeV/c];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.derived[kPiMinusMomentum]; } },
+            { cache.book_efficiency("energy", ";True Neutrino Energy [GeV];Events/bin", 600, 0, 6), [](const AnalysisEvent& e) { return e.mc_nu_energy; } },
+            { cache.book_efficiency("W", ";True W [GeV];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.mc_nu_W; } },
+            { cache.book_efficiency("QSqr", ";True Q^{2} [GeV^{2}];Events/bin", 300, 0, 3), [](const AnalysisEvent& e) { return e.mc_nu_QSqr; } }
+        };
+    }
 
-        bool piminus_reco = false;
-        if (event.mc_kshrt_piminus_tid) {
-            if (event.pfp_piminus_purity && event.pfp_piminus_completeness) {
-                for (size_t pfp_idx = 0; pfp_idx < event.pfp_piminus_purity->size(); ++pfp_idx) {
-                    float purity = event.pfp_piminus_purity->at(pfp_idx);
-                    float completeness = event.pfp_piminus_completeness->at(pfp_idx);
-                    if (purity >= 0.5 && completeness >= 0.1) {
-                        piminus_reco = true;
-                        piminus_pf_index = pfp_idx;  
-                        break;
-                    }
-                }
-            }
-        }
+    std::string get_name() const override { return "reco_event_effic"; }
+
+    // Truth variables, the momenta behind the derived columns used here, and the match index
+    std::vector<std::string> get_required_branches() const override
+    {
+        std::vector<std::string> branches = {"mc_has_muon", "mc_is_kshort_decay_pionic",
+                                             "mc_muon_tid", "mc_piplus_tid", "mc_piminus_tid",
+                                             "mc_kshrt_total_energy", "mc_kaon_decay_distance",
+                                             "nu_e", "W", "X", "Y", "QSqr",
+                                             "mc_muon_px", "mc_muon_py", "mc_muon_pz",
+                                             "mc_kshrt_piplus_px", "mc_kshrt_piplus_py", "mc_kshrt_piplus_pz",
+                                             "mc_kshrt_piminus_px", "mc_kshrt_piminus_py", "mc_kshrt_piminus_pz"};
+        const std::vector<std::string>& match = EventAssembler::get_match_index_branches();
+        branches.insert(branches.end(), match.begin(), match.end());
+        return branches;
+    }
 
-        // Check if muon, pion-plus, and pion-minus are well reconstructed and independent
-        if (muon_reco && piplus_reco && piminus_reco &&
-            muon_pf_index != piplus_pf_index &&
-            muon_pf_index != piminus_pf_index &&
-            piplus_pf_index != piminus_pf_index) 
-        {
-            event_effic_energy->Fill(true, kshort_energy);
-            event_effic_sep->Fill(true, kshort_sep);
-            event_effic_angle->Fill(true, angle_rad);
+    bool is_independent() const override { return true; }
 
-            // Fill momentum efficiencies
-            event_effic_muon_momentum->Fill(true, muon_momentum);
-            event_effic_piplus_momentum->Fill(true, piplus_momentum);
-            event_effic_piminus_momentum->Fill(true, piminus_momentum);
+    void begin() override
+    {
+        well_reconstructed_filled = 0;
+    }
+
+    void process(int entry, const AnalysisEvent& event) override
+    {
+        engine.fill(event);
 
-            event_effic_W->Fill(true, event.mc_nu_W);
-            event_effic_X->Fill(true, event.mc_nu_X);
-            event_effic_Y->Fill(true, event.mc_nu_Y);
-            event_effic_QSqr->Fill(true, event.mc_nu_QSqr);
+        if (!engine.get_selection_result(signal)) return;
 
-            event_effic_nu_energy->Fill(true, event.mc_nu_energy);
+        efficiency_map.fill(event, engine.get_selection_result(well_reconstructed));
+        for (const CachedVariable& cached : cached_variables) {
+            cache.fill_efficiency(cached.id, cached.variable(event), engine.get_selection_result(well_reconstructed));
+        }
 
+        if (engine.get_selection_result(well_reconstructed))
             well_reconstructed_filled++;
-        } else {
-            event_effic_energy->Fill(false, kshort_energy);
-            event_effic_sep->Fill(false, kshort_sep);
-            event_effic_angle->Fill(false, angle_rad);
+        else if (well_reconstructed_filled < 8)
+            display_queue.add(entry);
+    }
 
-            // Fill momentum efficiencies for false
-            event_effic_muon_momentum->Fill(false, muon_momentum);
-            event_effic_piplus_momentum->Fill(false, piplus_momentum);
-            event_effic_piminus_momentum->Fill(false, piminus_momentum);
+    void end() override
+    {
+        std::cout << "Well-reconstructed events filled: " << well_reconstructed_filled << std::endl;
 
-            event_effic_W->Fill(false, event.mc_nu_W);
-            event_effic_X->Fill(false, event.mc_nu_X);
-            event_effic_Y->Fill(false, event.mc_nu_Y);
-            event_effic_QSqr->Fill(false, event.mc_nu_QSqr);
+        display_queue.render();
 
-            event_effic_nu_energy->Fill(false, event.mc_nu_energy);
+        cache.write("plots/reco_event_effic_cache.root");
 
-            if (well_reconstructed_filled < 8)
-                display_assembler.plot_event(i);
-        }
+        // Plot the efficiency as a function of every declared variable
+        engine.plot_all([](TEfficiency* effic, const std::string& name) {
+            plot_efficiency(effic, ";" + std::string(effic->GetTotalHistogram()->GetXaxis()->GetTitle()) + ";Events/bin", name, 0, -1);
+        });
+
+        // Projections of the map, split by kaon energy
+        TEfficiency* sep_low_energy = efficiency_map.project("kshort_sep", { { "kshort_energy", 0.0, 1.0 } });
+        TEfficiency* sep_high_energy = efficiency_map.project("kshort_sep", { { "kshort_energy", 1.0, 3.0 } });
+        plot_efficiency(sep_low_energy, ";True K_{S}^{0} Decay Distance [cm] (E_{K} < 1 GeV);Events/bin", "kshort_sep_low_energy", 0, 24);
+        plot_efficiency(sep_high_energy, ";True K_{S}^{0} Decay Distance [cm] (E_{K} > 1 GeV);Events/bin", "kshort_sep_high_energy", 0, 24);
+
+        TEfficiency* energy_vs_sep = efficiency_map.project("kshort_energy", "kshort_sep");
+        TCanvas* c_map = new TCanvas("c_map", "", 800, 600);
+        energy_vs_sep->Draw("COLZ");
+        c_map->SaveAs("plots/Efficiency_kshort_energy_vs_sep.pdf");
+
+        delete sep_low_energy;
+        delete sep_high_energy;
+        delete energy_vs_sep;
+        delete c_map;
     }
 
-    std::cout << "Well-reconstructed events filled: " << well_reconstructed_filled << std::endl;
+private:
+    struct CachedVariable
+    {
+        int id;
+        EfficiencyEngine::Variable variable;
+    };
+
+    DisplayQueue display_queue;
+    EfficiencyEngine engine;
+    EfficiencyMap efficiency_map;
+    HistogramCache cache;
+    std::vector<CachedVariable> cached_variables;
 
-    // Plot the efficiency as a function of energy, separation, angle, and momentum
-    plot_efficiency(event_effic_energy, ";True Kaon-Short Energy [GeV]; Event/bin", "kshort_energy", 0.1, 3.0);
-    plot_efficiency(event_effic_sep, ";True K_{S}^{0} Decay-Distance [cm]; Events/bin", "kshort_sep", 0.1, 100.0);
-    plot_efficiency(event_effic_angle, ";True Decay Opening Angle [rad]; Event/bin", "opening_angle", 0.0, 3.14);
+    int signal, well_reconstructed;
+    int well_reconstructed_filled;
+};
 
-    plot_efficiency(event_effic_muon_momentum, ";True Muon Momentum [GeV/c]; Event/bin", "muon_momentum", 0.0, 3.0);
-    plot_efficiency(event_effic_piplus_momentum, ";True Pion-Plus Momentum [GeV/c]; Event/bin", "piplus_momentum", 0.0, 3.0);
-    plot_efficiency(event_effic_piminus_momentum, ";True Pion-Minus Momentum [GeV/c]; Event/bin", "piminus_momentum", 0.0, 3.0);
+void reco_event_effic()
+{
+    const char* data_dir = getenv("DATA_DIR");
+    std::string input_file = std::string(data_dir) + "/prod_strange_resample_fhc_run2_fhc_reco2_reco2_signalfilter_1000_analysis.root";
 
-    plot_efficiency(event_effic_W, ";True W; Events/bin", "W", 0, 100);
-    plot_efficiency(event_effic_X, ";True X; Events/bin", "X", 0, 100);
-    plot_efficiency(event_effic_Y, ";True Y; Events/bin", "Y", 0, 100);
-    plot_efficiency(event_effic_QSqr, ";True QSqr; Events/bin", "Qsqr", 0, 100);
+    const EventAssembler& event_assembler = EventAssembler::instance(input_file);
 
-    plot_efficiency(event_effic_nu_energy, ";True Neutrino Energy [GeV]; Enrties/bin", "energy", 0, -1);
+    RecoEventEfficAnalysis reco_event_effic_analysis(input_file);
+    AnalysisTrain train;
+    train.add(reco_event_effic_analysis);
+    train.run(event_assembler);
+}
 
-    // Cleanup
-    delete event_effic_energy;
-    delete event_effic_sep;
-    delete event_effic_angle;
-    delete event_effic_muon_momentum;
-    delete event_effic_piplus_momentum;
-    delete event_effic_piminus_momentum;
+// Re-render the cached efficiencies with new binning, without the event loop
+void reco_event_effic_replot(const std::string& cache_file = "plots/reco_event_effic_cache.root")
+{
+    HistogramCache cache = HistogramCache::read(cache_file);
+
+    struct Rebinning
+    {
+        std::string name;
+        int n_merge;
+        double x_min, x_max;
+    };
+
+    std::vector<Rebinning> rebinnings = {
+        { "kshort_energy", 20, 0.0, 3.0 },
+        { "kshort_sep", 10, 0, 24 },
+        { "opening_angle", 21, 0.0, 3.15 },
+        { "muon_momentum", 20, 0.0, 3.0 },
+        { "piplus_momentum", 20, 0.0, 3.0 },
+        { "piminus_momentum", 20, 0.0, 3.0 },
+        { "energy", 25, 0, 6 },
+        { "W", 10, 0, 3 },
+        { "QSqr", 10, 0, 3 }
+    };
+
+    for (const Rebinning& rebinning : rebinnings) {
+        TEfficiency* effic = cache.get_efficiency(rebinning.name, rebinning.n_merge, rebinning.x_min, rebinning.x_max);
+        plot_efficiency(effic, cache.get_title(rebinning.name), rebinning.name + "_rebinned", rebinning.x_min, rebinning.x_max);
+        delete effic;
+    }
 }
@@ -3,6 +3,9 @@
 #include "SliceAssembler.h"
 #include "PlotFunctions.h"
 #include "DisplayAssembler.h"
+#include "ThresholdScan.h"
+#include "Bootstrap.h"
+#include "StreamingStatistics.h"
 
 #include "TH2D.h"
 #include "TGraph2D.h"
@@ -14,38 +17,11 @@
 #include <vector>
 #include <cmath>
 
-#include <random>
-
-
-double calculate_mean(const std::vector<double>& values) {
-    double sum = 0.0;
-    for (double val : values) {
-        sum += val;
-    }
-    return (values.size() > 0) ? sum / values.size() : 0.0;
-}
-
-double calculate_stddev(const std::vector<double>& values, double mean) {
-    double sum_sq_diff = 0.0;
-    for (double val : values) {
-        sum_sq_diff += pow(val - mean, 2);
-    }
-    return (values.size() > 1) ? sqrt(sum_sq_diff / (values.size() - 1)) : 0.0;
-}
-
-void bootstrap_resample(const std::vector<double>& original_data, std::vector<double>& resampled_data, std::mt19937& rng) {
-    std::uniform_int_distribution<size_t> dist(0, original_data.size() - 1);
-    resampled_data.clear();
-    for (size_t i = 0; i < original_data.size(); ++i) {
-        resampled_data.push_back(original_data[dist(rng)]);
-    }
-}
 
 void reconstruction_analyser() 
 {
     const int num_bootstrap_samples = 1000; // Number of bootstrap resamples
-    std::mt19937 rng;  // Random number generator
-    rng.seed(std::random_device{}());
+    const uint64_t bootstrap_seed = 20241019;
 
     const char* data_dir = getenv("DATA_DIR");
     std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
@@ -53,105 +29,71 @@ void reconstruction_analyser()
     const EventAssembler& event_assembler = EventAssembler::instance(input_file);
     const DisplayAssembler& display_assembler = DisplayAssembler::instance(input_file);
 
-    int total_true_muons = 0;
     int num_events = event_assembler.get_num_events();
-    /*for (int i = 0; i < num_events; ++i) {
+
+    // Collect the best-matched muon once per event, then scan the cuts
+    ThresholdScan hit_cut_scan;
+    for (int i = 0; i < num_events; ++i) {
         const AnalysisEvent& event = event_assembler.get_event(i);
         if (!event.mc_has_muon) continue;
         if (!event.mc_is_kshort_decay_pionic) continue;
-        total_true_muons++;
+
+        // The backtracked particle with the most hits
+        const PfpMatch* best_match = event.match_index.get_best_match(event.mc_muon_tid);
+
+        if (best_match) {
+            hit_cut_scan.add_candidate(best_match->n_hits, best_match->purity, best_match->completeness, i);
+        }
+        else {
+            hit_cut_scan.add_unmatched();
+        }
     }
+    hit_cut_scan.finalise();
 
     // Vectors to store values for plotting
     std::vector<double> hit_cut_values;
     std::vector<double> avg_purity_values, avg_completeness_values, efficiency_values;
-    std::vector<double> purity_errors, completeness_errors, efficiency_errors;
+    std::vector<double> efficiency_errors;
     std::vector<double> hit_cut_widths; // To store x-axis error bars (bin widths)
 
     // Iterate over hit cuts and compute metrics
     int hit_cut_step = 10;
-    for (int hit_cut = 0; hit_cut <= 500; hit_cut += hit_cut_step) {
-        double total_purity = 0.0;
-        double total_completeness = 0.0;
-        int selected_muons = 0;
-
-        std::vector<double> purity_values;
-        std::vector<double> completeness_values;
-
-        for (int i = 0; i < num_events; ++i) {
-            const AnalysisEvent& event = event_assembler.get_event(i);
-            if (!event.mc_has_muon) continue;
-            if (!event.mc_is_kshort_decay_pionic) continue;
-
-            unsigned int muon_tid = event.mc_muon_tid;
-
-            int max_hits = -1;
-            size_t best_match_index = -1;
-
-            // Find the backtracked particle with the most hits
-            for (size_t j = 0; j < event.backtracked_tid->size(); ++j) {
-                if (event.backtracked_tid->at(j) == muon_tid) {
-                    int num_hits = event.pfnhits->at(j);
-
-                    if (num_hits > max_hits) {
-                        max_hits = num_hits;
-                        best_match_index = j;
-                    }
-                }
-            }
-
-            if (best_match_index != -1 && max_hits > hit_cut) {
-                float muon_purity = event.backtracked_purity->at(best_match_index);
-                float muon_completeness = event.backtracked_completeness->at(best_match_index);
-
-                total_purity += muon_purity;
-                total_completeness += muon_completeness;
-                selected_muons++;
-
-                purity_values.push_back(muon_purity);
-                completeness_values.push_back(muon_completeness);
-            }
+    int hit_cut_max = 500;
+    int num_hit_cuts = hit_cut_max / hit_cut_step + 1;
+
+    std::vector<double> purity_errors(num_hit_cuts), completeness_errors(num_hit_cuts);
+
+    // Bootstrapping for error estimation: the selected sample only grows as the
+    // cut loosens, so walk the cuts downwards and stream each candidate into the
+    // replica accumulators once
+    BootstrapWeights bootstrap_weights(num_bootstrap_samples, bootstrap_seed);
+    BootstrapMean purity_bootstrap(num_bootstrap_samples);
+    BootstrapMean completeness_bootstrap(num_bootstrap_samples);
+
+    size_t next_candidate = hit_cut_scan.get_num_candidates();
+    for (int k = num_hit_cuts - 1; k >= 0; --k) {
+        size_t first = hit_cut_scan.first_selected(k * hit_cut_step);
+        while (next_candidate > first) {
+            --next_candidate;
+            bootstrap_weights.generate(hit_cut_scan.get_keys()[next_candidate]);
+            purity_bootstrap.fill(bootstrap_weights, hit_cut_scan.get_purity()[next_candidate]);
+            completeness_bootstrap.fill(bootstrap_weights, hit_cut_scan.get_completeness()[next_candidate]);
         }
 
-        // Calculate average metrics for this hit cut
-        double avg_purity = (selected_muons > 0) ? total_purity / selected_muons : 0.0;
-        double avg_completeness = (selected_muons > 0) ? total_completeness / selected_muons : 0.0;
-        double efficiency = (total_true_muons > 0) ? double(selected_muons) / total_true_muons : 0.0;
-
-        // Calculate the binomial error for efficiency
-        double efficiency_error = (total_true_muons > 0) ? sqrt(efficiency * (1 - efficiency) / total_true_muons) : 0.0;
-
-        // Bootstrapping for error estimation
-        std::vector<double> resampled_purity_means;
-        std::vector<double> resampled_completeness_means;
-
-        for (int n = 0; n < num_bootstrap_samples; ++n) {
-            std::vector<double> purity_resample, completeness_resample;
-
-            // Resample purity and completeness values with replacement
-            bootstrap_resample(purity_values, purity_resample, rng);
-            bootstrap_resample(completeness_values, completeness_resample, rng);
-
-            double resampled_purity_mean = calculate_mean(purity_resample);
-            double resampled_completeness_mean = calculate_mean(completeness_resample);
-
-            resampled_purity_means.push_back(resampled_purity_mean);
-            resampled_completeness_means.push_back(resampled_completeness_mean);
-        }
+        purity_errors[k] = purity_bootstrap.get_error();
+        completeness_errors[k] = completeness_bootstrap.get_error();
+    }
 
-        // Compute the standard deviation of the resampled means (bootstrap errors)
-        double purity_error = calculate_stddev(resampled_purity_means, avg_purity);
-        double completeness_error = calculate_stddev(resampled_completeness_means, avg_completeness);
+    for (int k = 0; k < num_hit_cuts; ++k) {
+        int hit_cut = k * hit_cut_step;
+        ThresholdScanPoint point = hit_cut_scan.evaluate(hit_cut);
 
         // Store values for plotting
         hit_cut_values.push_back(hit_cut);
-        avg_purity_values.push_back(avg_purity);
-        avg_completeness_values.push_back(avg_completeness);
-        efficiency_values.push_back(efficiency);
-
-        purity_errors.push_back(purity_error);
-        completeness_errors.push_back(completeness_error);
-        efficiency_errors.push_back(efficiency_error);
+        avg_purity_values.push_back(point.mean_purity);
+        avg_completeness_values.push_back(point.mean_completeness);
+        efficiency_values.push_back(point.efficiency);
+        efficiency_errors.push_back(point.efficiency_error);
 
         // Set the x-axis error bar as half the bin width
         hit_cut_widths.push_back(hit_cut_step / 2.0);
@@ -216,42 +158,42 @@ void reconstruction_analyser()
     delete canvas;
     delete graph_purity;
     delete graph_completeness;
-    delete graph_efficiency;*/
+    delete graph_efficiency;
 
 
     TH2D *h2_purity_completeness = new TH2D("h2_purity_completeness", "", 
                                             10, 0, 1, 10, 0, 1);
 
+    RunningStatistics purity_statistics, completeness_statistics;
+    TDigest purity_quantiles, completeness_quantiles;
+
     // Iterate over events
     for (int i = 0; i < num_events; ++i) {
         const AnalysisEvent& event = event_assembler.get_event(i);
         if (!event.mc_has_muon) continue;
         //if (!event.mc_is_kshort_decay_pionic) continue;
 
-        unsigned int muon_tid = event.mc_muon_tid;
+        // The backtracked particle with the most hits
+        const PfpMatch* best_match = event.match_index.get_best_match(event.mc_muon_tid);
 
-        int max_hits = -1;
-        size_t best_match_index = -1;
+        if (best_match && best_match->n_hits > 50) {
+            float muon_purity = best_match->purity;
+            float muon_completeness = best_match->completeness;
 
-        // Find the backtracked particle with the most hits
-        for (size_t j = 0; j < event.backtracked_tid->size(); ++j) {
-            if (event.backtracked_tid->at(j) == muon_tid) {
-                int num_hits = event.pfnhits->at(j);
+            h2_purity_completeness->Fill(muon_purity, muon_completeness);
 
-                if (num_hits > max_hits) {
-                    max_hits = num_hits;
-                    best_match_index = j;
-                }
-            }
+            purity_statistics.fill(muon_purity);
+            completeness_statistics.fill(muon_completeness);
+            purity_quantiles.fill(muon_purity);
+            completeness_quantiles.fill(muon_completeness);
         }
+    }
 
-        if (best_match_index != -1 && max_hits > 50) {
-            float muon_purity = event.backtracked_purity->at(best_match_index);
-            float muon_completeness = event.backtracked_completeness->at(best_match_index);
+    std::cout << "Muon purity: mean " << purity_statistics.get_mean() << " +/- " << purity_statistics.get_stddev()
+              << ", median " << purity_quantiles.get_median() << std::endl;
+    std::cout << "Muon completeness: mean " << completeness_statistics.get_mean() << " +/- " << completeness_statistics.get_stddev()
+              << ", median " << completeness_quantiles.get_median() << std::endl;
 
-            h2_purity_completeness->Fill(muon_purity, muon_completeness);
-        }
-    }
     // Create a canvas for plotting the TH2D histogram
     TCanvas* c_purity_completeness = new TCanvas("c_purity_completeness", "Purity vs Completeness", 800, 600);
 
@@ -1,7 +1,8 @@
 #include "AnalysisEvent.h"
 #include "EventAssembler.h"
-#include "DisplayAssembler.h"
+#include "DisplayQueue.h"
 #include "PlotFunctions.h"
+#include "CategoryHistograms.h"
 
 #include "FiducialVolumeSelector.h"
 
@@ -15,20 +16,27 @@ void selection_analyser()
     std::string input_file = std::string(data_dir) + "/analysis_prod_strange_resample_fhc_run2_fhc_reco2_reco2.root";
 
     const EventAssembler& event_assembler = EventAssembler::instance(input_file);
-    const DisplayAssembler& display_assembler = DisplayAssembler::instance(input_file);
+    DisplayQueue display_queue(input_file, 30);
 
     FiducialVolumeSelector fv_selector(FiducialVolumeSelector::kWirecell);
 
+    // Category breakdown of the events passing the fiducial volume selection
+    CategoryHistograms fv_histograms("fv");
+    fv_histograms.add_variable("nu_energy", ";True Neutrino Energy [GeV];Events", 30, 0, 6, [](const AnalysisEvent& e) { return e.mc_nu_energy; });
+    fv_histograms.add_variable("topological_score", ";Topological Score;Events", 20, 0, 1, [](const AnalysisEvent& e) { return e.topological_score; });
+    fv_histograms.add_variable("n_pf_particles", ";Number of PFParticles;Events", 15, 0, 15, [](const AnalysisEvent& e) { return e.n_pf_particles; });
+    fv_histograms.add_variable("reco_vtx_dist", ";Reco-True Vertex Distance [cm];Events", 25, 0, 50, [](const AnalysisEvent& e) { return e.derived[kRecoVertexDistance]; });
+
     int num_events = event_assembler.get_num_events();
-    int disp_count = 0;
     for (int i = 0; i < num_events; ++i) {
         const AnalysisEvent& event = event_assembler.get_event(i);
-        if (event.mc_has_muon && event.mc_is_kshort_decay_pionic && disp_count < 30)
-        {
-            display_assembler.plot_event(i);
-            disp_count++;
-        }
+        if (event.mc_has_muon && event.mc_is_kshort_decay_pionic) display_queue.add(i);
 
         bool fv_pass = fv_selector.pass_selection(event);
+        if (fv_pass) fv_histograms.fill(event);
     }
+
+    fv_histograms.plot_all_stacked("./plots");
+
+    display_queue.render();
 }